@@ -0,0 +1,16 @@
+#version 330 core
+
+// Interpolated values from the vertex shaders
+in vec2 fragTexCoord;
+flat in float fragLayer;
+
+// output data
+out vec3 color;
+
+// One layer per animation frame
+uniform sampler2DArray spriteSampler;
+
+void main()
+{
+    color = texture( spriteSampler, vec3(fragTexCoord, fragLayer) ).rgb;
+}
\ No newline at end of file
@@ -0,0 +1,29 @@
+#version 330 core
+
+// input data : sent from main program
+layout (location = 0) in vec3 vertexPosition;
+layout (location = 2) in vec2 vertexTexCoord;
+
+// per-instance data : one entry per sprite
+layout (location = 3) in vec4 instanceOffsetScale; // xyz offset, w scale
+layout (location = 4) in vec3 instanceClip; // first layer, number of frames, fps
+
+uniform mat4 MVP;
+uniform float time;
+
+// output data : used by fragment shader
+out vec2 fragTexCoord;
+flat out float fragLayer;
+
+void main ()
+{
+    // Clips loop, see animation.h
+    float frame = mod(floor(time * instanceClip.z), instanceClip.y);
+    fragLayer = instanceClip.x + frame;
+    fragTexCoord = vertexTexCoord;
+
+    vec4 v = vec4(vertexPosition * instanceOffsetScale.w + instanceOffsetScale.xyz, 1);
+
+    // Output position of the vertex, in clip space : MVP * position
+    gl_Position = MVP * v;
+}
\ No newline at end of file
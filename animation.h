@@ -0,0 +1,37 @@
+#ifndef ANIMATION_H
+#define ANIMATION_H
+
+/* Sprite animation clips. Every clip loops from the start of animClock,
+   set once per frame, and the sprite shader picks its frame, a layer of
+   its array texture, as floor(animClock * fps) mod numFrames, so nothing
+   is evaluated on the CPU but the clock */
+
+struct AnimClip {
+  const char *name;
+  int numFrames;
+  float fps;
+};
+
+enum {
+  CLIP_TIMER,
+  CLIP_WATER,
+  CLIP_STARS,
+  CLIP_SOLDIER,
+  CLIP_DRAGON,
+  CLIP_LIVES,
+  NUM_CLIPS
+};
+
+/* Rates match the old per-function frame counters at 60 Hz vsync */
+AnimClip clips[NUM_CLIPS] = {
+  { "timer",   16,  20 }, // every 3 frames
+  { "water",   25,   4 }, // every 15 frames
+  { "stars",    3,  12 }, // every 5 frames
+  { "soldier", 120, 30 }, // every 2 frames
+  { "dragon",  12,  10 }, // every 6 frames
+  { "lives",   22,  12 }  // every 5 frames
+};
+
+double animClock = 0;
+
+#endif
@@ -0,0 +1,99 @@
+#ifndef BITBOARD_H
+#define BITBOARD_H
+
+#include <stdint.h>
+#ifdef __SSE2__
+#include <emmintrin.h>
+#endif
+
+/* A 10x10 board packed into 128 bits, cell (i, j) is bit i*10 + j. The
+   whole board fits one SSE register, so and/or/andnot and shifts work on
+   every cell at once; there is a plain two word fallback without SSE2.
+   Bits 100..127 are always kept clear */
+
+struct alignas(16) Bitboard {
+  uint64_t w[2];
+
+  bool test(int i, int j) const {
+    if(i < 0 || i > 9 || j < 0 || j > 9) return false; // off the board
+    int b = i*10 + j;
+    return (w[b >> 6] >> (b & 63)) & 1;
+  }
+  void set(int i, int j) { int b = i*10 + j; w[b >> 6] |= 1ULL << (b & 63); }
+  void clear(int i, int j) { int b = i*10 + j; w[b >> 6] &= ~(1ULL << (b & 63)); }
+  void assign(int i, int j, bool on) { if(on) set(i, j); else clear(i, j); }
+  bool any() const { return w[0] | w[1]; }
+  int count() const { return __builtin_popcountll(w[0]) + __builtin_popcountll(w[1]); }
+};
+
+inline Bitboard bitboard(uint64_t lo, uint64_t hi) {
+  Bitboard b;
+  b.w[0] = lo;
+  b.w[1] = hi;
+  return b;
+}
+
+const Bitboard emptyBoard = bitboard(0, 0);
+const Bitboard fullBoard = bitboard(~0ULL, (1ULL << 36) - 1);
+
+#ifdef __SSE2__
+inline __m128i load(const Bitboard &b) { return _mm_load_si128((const __m128i*)b.w); }
+inline Bitboard store(__m128i v) { Bitboard b; _mm_store_si128((__m128i*)b.w, v); return b; }
+
+inline Bitboard operator&(const Bitboard &a, const Bitboard &b) { return store(_mm_and_si128(load(a), load(b))); }
+inline Bitboard operator|(const Bitboard &a, const Bitboard &b) { return store(_mm_or_si128(load(a), load(b))); }
+inline Bitboard operator^(const Bitboard &a, const Bitboard &b) { return store(_mm_xor_si128(load(a), load(b))); }
+/* a & ~b in one instruction */
+inline Bitboard andNot(const Bitboard &a, const Bitboard &b) { return store(_mm_andnot_si128(load(b), load(a))); }
+
+/* Shifts by 'n' < 64 cells, the bits crossing between words are carried */
+inline Bitboard operator<<(const Bitboard &a, int n) {
+  __m128i v = load(a);
+  __m128i carry = _mm_srl_epi64(_mm_slli_si128(v, 8), _mm_cvtsi32_si128(64 - n));
+  return store(_mm_and_si128(_mm_or_si128(_mm_sll_epi64(v, _mm_cvtsi32_si128(n)), carry), load(fullBoard)));
+}
+inline Bitboard operator>>(const Bitboard &a, int n) {
+  __m128i v = load(a);
+  __m128i carry = _mm_sll_epi64(_mm_srli_si128(v, 8), _mm_cvtsi32_si128(64 - n));
+  return store(_mm_or_si128(_mm_srl_epi64(v, _mm_cvtsi32_si128(n)), carry));
+}
+#else
+inline Bitboard operator&(const Bitboard &a, const Bitboard &b) { return bitboard(a.w[0] & b.w[0], a.w[1] & b.w[1]); }
+inline Bitboard operator|(const Bitboard &a, const Bitboard &b) { return bitboard(a.w[0] | b.w[0], a.w[1] | b.w[1]); }
+inline Bitboard operator^(const Bitboard &a, const Bitboard &b) { return bitboard(a.w[0] ^ b.w[0], a.w[1] ^ b.w[1]); }
+inline Bitboard andNot(const Bitboard &a, const Bitboard &b) { return bitboard(a.w[0] & ~b.w[0], a.w[1] & ~b.w[1]); }
+
+inline Bitboard operator<<(const Bitboard &a, int n) {
+  return bitboard(a.w[0] << n, (a.w[1] << n | a.w[0] >> (64 - n)) & fullBoard.w[1]);
+}
+inline Bitboard operator>>(const Bitboard &a, int n) {
+  return bitboard(a.w[0] >> n | a.w[1] << (64 - n), a.w[1] >> n);
+}
+#endif
+
+inline Bitboard operator~(const Bitboard &a) { return andNot(fullBoard, a); }
+inline Bitboard &operator&=(Bitboard &a, const Bitboard &b) { return a = a & b; }
+inline Bitboard &operator|=(Bitboard &a, const Bitboard &b) { return a = a | b; }
+inline bool operator==(const Bitboard &a, const Bitboard &b) { return a.w[0] == b.w[0] && a.w[1] == b.w[1]; }
+
+Bitboard boardFromCells(const bool cells[10][10]) {
+  Bitboard b = emptyBoard;
+  for(int i = 0; i < 10; i++) for(int j = 0; j < 10; j++) if(cells[i][j]) b.set(i, j);
+  return b;
+}
+
+Bitboard columnsBoard(int from, int to) {
+  Bitboard b = emptyBoard;
+  for(int i = 0; i < 10; i++) for(int j = from; j <= to; j++) b.set(i, j);
+  return b;
+}
+
+Bitboard diagonalsBoard() {
+  Bitboard b = emptyBoard;
+  for(int i = 0; i < 10; i++) b.set(i, i), b.set(i, 9 - i);
+  return b;
+}
+
+const Bitboard diagonals = diagonalsBoard(); // always present and still
+
+#endif
@@ -0,0 +1,227 @@
+#ifndef BOT_H
+#define BOT_H
+
+#include <algorithm>
+#include <functional>
+#include "game.h"
+#include "input.h"
+
+/* A computer player, for the headless tools, soak tests and --bot. It plays
+   through applyInput() like the keyboard does, so it is bound by the same
+   rules, and its events reach the recorder like the keyboard's.
+
+   Whenever the player stands on a cell the bot plans a route to the goal
+   with A* over the cells, taking steps and jumps as the arrows and the jump
+   key make them. Routes are timed: the search knows when the player gets
+   to every cell, so it jumps a moving block only while the block stays low,
+   and walks through an obstacle's cell only once the obstacles have moved.
+   Where it has to wait the route says how long. Coins along the way count
+   as a little time saved, so a route through them wins a close call.
+   A plan is a few microseconds, cheap enough to redo on every tick */
+
+struct Bot {
+  int key = -1;      // arrow held down, -1 when idle
+  bool jump = false; // the arrow was pressed with the jump key
+  int targetX = 0, targetZ = 0;
+  int house = 1;     // picked on the menu
+  long plans = 0;    // routes searched
+};
+
+/* Moves as [direction - 1], direction as in moveFlag() */
+const int botDX[4] = { 1, -1, 0, 0 };
+const int botDZ[4] = { 0, 0, 1, -1 };
+
+/* Move timings in seconds, from the per tick distances of drawMove() and
+   drawJump(). A jump passes over the middle cell from about 0.2 to 0.8 of
+   the way and enters the last cell at 0.75, a step enters it half way */
+const double botJumpTime = 4 / (0.05 * 60);
+const double botJumpOver = 0.2, botJumpAcross = 0.6, botJumpEnter = 0.75;
+const float botLowBlock = 1.1;   // a jump at least 5.2 high hits a block within 4
+const double botMaxWait = 15;    // longer than any block's cycle
+
+double botStepTime(const Game &g) {
+  return 2 / (0.1 * 60 * g.speed);
+}
+
+/* The first move of a route, the rest is planned again on arrival */
+struct BotMove {
+  int key;         // INPUT_UP .. INPUT_LEFT
+  bool jump;
+  int i, j;        // landing cell
+  double depart;   // game time to set off, later than now to wait
+};
+
+/* Earliest time from 'time' at which a jump can set off over block 'n':
+   the block must stay under botLowBlock while the player is over it. The
+   block is low for a window around the bottom of every cycle, which
+   waveAt() puts at whole phase + speed * time plus a half, so this is a
+   few divisions instead of sampling. -1 when the block never stays low
+   long enough */
+double botJumpWindow(const Entities &e, int n, double time) {
+  if(e.amplitude[n] <= 0) return e.baseY[n] <= botLowBlock ? time : -1;
+  // Low while |4f - 2| <= c, f the fraction of the cycle
+  float c = (botLowBlock - e.baseY[n]) / e.amplitude[n] + 1;
+  if(c >= 2) return time;
+  if(c < 0) return -1;
+  double lo = (2 - c) / 4, hi = (2 + c) / 4 - botJumpAcross * botJumpTime * e.speed[n];
+  if(hi < lo) return -1;
+  double s = e.phase[n] + e.speed[n] * (time + botJumpOver * botJumpTime);
+  double f = s - floor(s);
+  if(f >= lo && f <= hi) return time;
+  return time + (f < lo ? lo - f : 1 - f + lo) / e.speed[n];
+}
+
+/* A* from the player's cell to the goal. The cost of a route is the time
+   it takes, waits included, less a quarter of a move for every coin it
+   picks up, so the cost of a move never drops under three quarters of a
+   step and the distance times that is a lower bound for the heuristic.
+   Obstacles and coins are known until they move again, after that the
+   cells are taken as clear and the next plans see the new ones */
+bool botPlan(const Game &g, BotMove &first) {
+  const Entities &e = g.entities;
+  const int p = playerEntity;
+  int start = e.cellX[p]*10 + e.cellZ[p], goal = 99;
+  if(e.cellX[p] < 0 || e.cellX[p] > 9 || e.cellZ[p] < 0 || e.cellZ[p] > 9 || start == goal) return false;
+  if(g.speed <= 0) return false;
+
+  // What stands on every cell, from one pass over the store
+  signed char obstacle[100], coin[100];
+  short block[100];
+  for(int c = 0; c < 100; c++) obstacle[c] = coin[c] = 0, block[c] = -1;
+  for(int n = 0; n < e.count; n++) {
+    int c = e.cellX[n]*10 + e.cellZ[n];
+    if(e.cellX[n] < 0 || e.cellX[n] > 9 || e.cellZ[n] < 0 || e.cellZ[n] > 9) continue;
+    if(e.kind[n] == ENTITY_OBSTACLE) obstacle[c] = 1;
+    else if(e.kind[n] == ENTITY_COIN) coin[c] = 1;
+    else if(e.kind[n] == ENTITY_BLOCK) block[c] = n;
+  }
+  // Time of the tick on which respawn() places new ones
+  long due = timerDue(g.timers, TIMER_RESPAWN);
+  double regen = due < 0 ? INFINITY : g.time + (due - g.tick) * tickLength;
+  Bitboard open = andNot(g.isPresent, g.isMoving);
+
+  double stepTime = botStepTime(g);
+  double perCell = 0.75 * min(stepTime, botJumpTime / 2);
+  float cost[100];
+  double arrive[100];
+  short from[100];
+  BotMove via[100];
+  bool closed[100];
+  for(int c = 0; c < 100; c++) cost[c] = INFINITY, closed[c] = false;
+
+  // Open list as a binary heap of (cost + heuristic, cell). A cell goes in
+  // once per improvement, at most once per move into it
+  pair<float, int> heap[8*100 + 1];
+  int heapSize = 0;
+  cost[start] = 0, arrive[start] = g.time, from[start] = -1;
+  heap[heapSize++] = make_pair((float)((18 - e.cellX[p] - e.cellZ[p]) * perCell), start);
+
+  while(heapSize) {
+    pop_heap(heap, heap + heapSize, greater< pair<float, int> >());
+    int c = heap[--heapSize].second;
+    if(closed[c]) continue;
+    closed[c] = true;
+    if(c == goal) break;
+    int i = c / 10, j = c % 10;
+
+    for(int k = 0; k < 8; k++) {
+      bool jump = k >= 4;
+      int d = k % 4, step = jump ? 2 : 1;
+      int ni = i + botDX[d] * step, nj = j + botDZ[d] * step;
+      if(!open.test(ni, nj)) continue;
+      int n = ni*10 + nj, mid = (i + botDX[d])*10 + j + botDZ[d];
+      if(closed[n]) continue;
+
+      double duration = jump ? botJumpTime : stepTime;
+      double enter = jump ? botJumpEnter * duration : duration / 2;
+      double depart = arrive[c];
+      bool hit = obstacle[n] || (jump && obstacle[mid]);
+      for(int pass = 0; pass < 2 && depart >= 0; pass++) {
+        // Nothing is hit before the obstacles move, and no move is under
+        // way when new ones land, they may land on the cell ahead
+        if(depart < regen && (hit || depart + enter >= regen)) depart = regen;
+        if(jump && block[mid] >= 0) depart = botJumpWindow(e, block[mid], depart);
+      }
+      if(depart < 0 || depart - arrive[c] > botMaxWait) continue;
+
+      bool coins = (coin[n] && depart + enter < regen) || (jump && coin[mid] && depart + botJumpOver * duration < regen);
+      float total = cost[c] + (depart - arrive[c]) + duration - (coins ? duration / 4 : 0);
+      if(total >= cost[n]) continue;
+      cost[n] = total;
+      arrive[n] = depart + duration;
+      from[n] = c;
+      BotMove m = { INPUT_UP + d, jump, ni, nj, depart };
+      via[n] = m;
+      heap[heapSize++] = make_pair((float)(total + (18 - ni - nj) * perCell), n);
+      push_heap(heap, heap + heapSize, greater< pair<float, int> >());
+    }
+  }
+  if(!closed[goal]) return false;
+  int c = goal;
+  while(from[c] != start) c = from[c];
+  first = via[c];
+  return true;
+}
+
+/* Key events go through the rules and on to the recorder, if any */
+void botKey(Game &g, int key, bool press) {
+  InputEvent e;
+  e.time = g.time;
+  e.key = key;
+  e.press = press;
+  e.relative = false;
+  applyInput(g, e);
+  if(onInputApplied) onInputApplied(g, e);
+}
+
+void botRelease(Bot &b, Game &g) {
+  if(b.key < 0) return;
+  botKey(g, b.key, false);
+  if(b.jump) botKey(g, INPUT_JUMP, false);
+  b.key = -1;
+  b.jump = false;
+}
+
+/* Has the player walked onto the target cell's centre */
+bool botArrived(const Bot &b, const Game &g) {
+  float x = b.targetX*2 + shiftX, z = b.targetZ*2 + shiftZ;
+  float px = g.entities.x[playerEntity], pz = g.entities.z[playerEntity];
+  if(b.key == INPUT_UP) return px >= x - 0.05;
+  if(b.key == INPUT_DOWN) return px <= x + 0.05;
+  if(b.key == INPUT_RIGHT) return pz >= z - 0.05;
+  return pz <= z + 0.05;
+}
+
+/* Called before every stepGame() */
+void botTick(Bot &b, Game &g) {
+  if(g.onMenu) {
+    botKey(g, INPUT_HOUSE1 + b.house - 1, false);
+    return;
+  }
+  if(g.playerWin || g.playerLose || g.playerFall || g.playerAnimate) {
+    botRelease(b, g);
+    return;
+  }
+  if(g.playerJumpUp || g.playerJumpDown || g.playerJumpRight || g.playerJumpLeft) return;
+  bool walking = g.playerMoveUp || g.playerMoveDown || g.playerMoveRight || g.playerMoveLeft;
+  if(b.key >= 0) {
+    // Still on the way, unless the rules stopped the player
+    if(!b.jump && walking && !botArrived(b, g)) return;
+    botRelease(b, g);
+  }
+  if(g.speed <= 0) {
+    botKey(g, INPUT_FASTER, false);
+    return;
+  }
+
+  BotMove m;
+  b.plans++;
+  if(!botPlan(g, m) || m.depart > g.time + tickLength / 2) return; // nothing yet, plan again next tick
+  b.key = m.key;
+  b.jump = m.jump;
+  b.targetX = m.i, b.targetZ = m.j;
+  if(b.jump) botKey(g, INPUT_JUMP, true);
+  botKey(g, b.key, true);
+}
+
+#endif
@@ -0,0 +1,176 @@
+#ifndef BROADPHASE_H
+#define BROADPHASE_H
+
+#include "rng.h"
+#include "sweep.h"
+#include "input.h"
+
+/* Broadphase for many moving actors (NPCs, projectiles, players): a uniform
+   grid with the board's cells. Each grid cell keeps a doubly linked list of
+   the actors in it, threaded through per actor arrays, so inserting,
+   removing and moving an actor are O(1) and a query only visits the cells
+   it overlaps. Actors off the grid share one extra list, so nothing is
+   ever lost. Actors are plain indices into whatever store holds them */
+
+struct Broadphase {
+  int minI = 0, minJ = 0, width = 0, depth = 0; // the grid covers cells minI.., minJ..
+  vector<int> head;  // first actor per cell, the last entry is off the grid, -1 when empty
+  vector<int> next;  // per actor, -1 at the end of a list
+  vector<int> prev;  // per actor, -1 at the head of a list
+  vector<int> cell;  // per actor, -1 when not inserted
+};
+
+/* A grid over cells (minI, minJ) to (maxI, maxJ) for up to 'actors' actors */
+void initBroadphase(Broadphase &b, int minI, int minJ, int maxI, int maxJ, int actors) {
+  b.minI = minI, b.minJ = minJ;
+  b.width = maxI - minI + 1, b.depth = maxJ - minJ + 1;
+  b.head.assign(b.width * b.depth + 1, -1);
+  b.next.assign(actors, -1);
+  b.prev.assign(actors, -1);
+  b.cell.assign(actors, -1);
+}
+
+/* Grid slot of board cell (i, j) */
+int broadphaseSlot(const Broadphase &b, int i, int j) {
+  i -= b.minI, j -= b.minJ;
+  if(i < 0 || i >= b.width || j < 0 || j >= b.depth) return b.width * b.depth;
+  return i * b.depth + j;
+}
+
+void linkActor(Broadphase &b, int actor, int slot) {
+  b.cell[actor] = slot;
+  b.prev[actor] = -1;
+  b.next[actor] = b.head[slot];
+  if(b.head[slot] >= 0) b.prev[b.head[slot]] = actor;
+  b.head[slot] = actor;
+}
+
+void removeActor(Broadphase &b, int actor) {
+  int slot = b.cell[actor];
+  if(slot < 0) return;
+  if(b.prev[actor] >= 0) b.next[b.prev[actor]] = b.next[actor];
+  else b.head[slot] = b.next[actor];
+  if(b.next[actor] >= 0) b.prev[b.next[actor]] = b.prev[actor];
+  b.cell[actor] = -1;
+}
+
+void insertActor(Broadphase &b, int actor, float x, float z) {
+  removeActor(b, actor);
+  linkActor(b, actor, broadphaseSlot(b, cellOf(x, shiftX), cellOf(z, shiftZ)));
+}
+
+/* Call every time the actor moves, only a change of cell costs anything */
+void moveActor(Broadphase &b, int actor, float x, float z) {
+  int slot = broadphaseSlot(b, cellOf(x, shiftX), cellOf(z, shiftZ));
+  if(slot == b.cell[actor]) return;
+  removeActor(b, actor);
+  linkActor(b, actor, slot);
+}
+
+/* Appends the actors in every cell overlapping [minX, maxX] x [minZ, maxZ]
+   to 'found'. They may lie outside the box, the narrowphase decides */
+void queryBox(const Broadphase &b, float minX, float minZ, float maxX, float maxZ, vector<int> &found) {
+  int i0 = cellOf(minX, shiftX), i1 = cellOf(maxX, shiftX);
+  int j0 = cellOf(minZ, shiftZ), j1 = cellOf(maxZ, shiftZ);
+  bool offGrid = i0 < b.minI || j0 < b.minJ || i1 >= b.minI + b.width || j1 >= b.minJ + b.depth;
+  i0 = max(i0, b.minI), j0 = max(j0, b.minJ);
+  i1 = min(i1, b.minI + b.width - 1), j1 = min(j1, b.minJ + b.depth - 1);
+  for(int i = i0; i <= i1; i++) for(int j = j0; j <= j1; j++)
+    for(int a = b.head[broadphaseSlot(b, i, j)]; a >= 0; a = b.next[a]) found.push_back(a);
+  if(offGrid)
+    for(int a = b.head[b.width * b.depth]; a >= 0; a = b.next[a]) found.push_back(a);
+}
+
+/* Narrowphase */
+
+struct Box {
+  float minX, minY, minZ;
+  float maxX, maxY, maxZ;
+};
+
+/* The player's body around its entity position, from the feet to the top
+   of the head as drawn */
+Box playerBox(float x, float y, float z) {
+  Box b = { x - 0.5f, y, z - 0.5f, x + 0.5f, y + 3.5f, z + 0.5f };
+  return b;
+}
+
+/* Sphere against box: the box's closest point to the centre is within r */
+bool sphereHitsBox(float x, float y, float z, float r, const Box &b) {
+  float dx = x - max(b.minX, min(x, b.maxX));
+  float dy = y - max(b.minY, min(y, b.maxY));
+  float dz = z - max(b.minZ, min(z, b.maxZ));
+  return dx*dx + dy*dy + dz*dz <= r*r;
+}
+
+/* Benchmark for --bench-broadphase: 'actors' spheres wander a 100 x 100
+   cell arena at up to 0.3 units a tick while 64 players look for hits
+   every tick. Every 60th tick the hits are checked against testing every
+   pair */
+int runBroadphaseBench(int actors, unsigned seed) {
+  const int arena = 100, players = 64, ticks = 600;
+  const float radius = 0.3f;
+  float lowX = shiftX - 1, highX = arena*2 + shiftX - 1, lowZ = shiftZ - 1, highZ = arena*2 + shiftZ - 1;
+
+  Rng rng;
+  rngSeed(rng, seed, 5);
+  vector<float> x(actors), y(actors), z(actors), vx(actors), vz(actors);
+  for(int a = 0; a < actors; a++) {
+    x[a] = lowX + rngBelow(rng, 20000) / 20000.0f * (highX - lowX);
+    z[a] = lowZ + rngBelow(rng, 20000) / 20000.0f * (highZ - lowZ);
+    y[a] = 4 + rngBelow(rng, 1000) / 1000.0f;
+    vx[a] = (rngBelow(rng, 601) - 300) / 1000.0f;
+    vz[a] = (rngBelow(rng, 601) - 300) / 1000.0f;
+  }
+  vector<float> px(players), pz(players);
+  for(int k = 0; k < players; k++) {
+    px[k] = (rngBelow(rng, arena) * 2 + shiftX);
+    pz[k] = (rngBelow(rng, arena) * 2 + shiftZ);
+  }
+
+  Broadphase b;
+  initBroadphase(b, 0, 0, arena - 1, arena - 1, actors);
+  for(int a = 0; a < actors; a++) insertActor(b, a, x[a], z[a]);
+
+  vector<int> found, broad(players);
+  long hits = 0, candidates = 0, mismatches = 0;
+  double moveTime = 0, queryTime = 0;
+  for(int t = 0; t < ticks; t++) {
+    double start = inputClock();
+    for(int a = 0; a < actors; a++) {
+      x[a] += vx[a], z[a] += vz[a];
+      if(x[a] < lowX || x[a] >= highX) vx[a] = -vx[a], x[a] += 2*vx[a];
+      if(z[a] < lowZ || z[a] >= highZ) vz[a] = -vz[a], z[a] += 2*vz[a];
+    }
+    for(int a = 0; a < actors; a++) moveActor(b, a, x[a], z[a]);
+    double moved = inputClock();
+
+    for(int k = 0; k < players; k++) {
+      Box box = playerBox(px[k], 4.2, pz[k]);
+      found.clear();
+      queryBox(b, box.minX - radius, box.minZ - radius, box.maxX + radius, box.maxZ + radius, found);
+      candidates += found.size();
+      broad[k] = 0;
+      for(int n = 0; n < found.size(); n++) broad[k] += sphereHitsBox(x[found[n]], y[found[n]], z[found[n]], radius, box);
+      hits += broad[k];
+    }
+    queryTime += inputClock() - moved;
+    moveTime += moved - start;
+
+    if(t % 60) continue;
+    for(int k = 0; k < players; k++) {
+      Box box = playerBox(px[k], 4.2, pz[k]);
+      int brute = 0;
+      for(int a = 0; a < actors; a++) brute += sphereHitsBox(x[a], y[a], z[a], radius, box);
+      if(brute != broad[k]) mismatches++;
+    }
+  }
+
+  printf("%d actors, %d players, %d ticks\n", actors, players, ticks);
+  printf("Moving: %.1f ns per actor per tick\n", moveTime / ticks / actors * 1e9);
+  printf("Queries: %.2f us per player, %.1f candidates for %.2f hits\n", queryTime / ticks / players * 1e6, (double)candidates / ticks / players, (double)hits / ticks / players);
+  printf("Against testing every pair: %ld mismatches\n", mismatches);
+  return mismatches ? 1 : 0;
+}
+
+#endif
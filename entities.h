@@ -0,0 +1,248 @@
+#ifndef ENTITIES_H
+#define ENTITIES_H
+
+#include <math.h>
+#include <chrono>
+#ifdef __SSE2__
+#include <emmintrin.h>
+#endif
+#include "bitboard.h"
+#include "rng.h"
+
+/* Everything on the board that moves or can be picked up, stored as a
+   structure of arrays: one contiguous array per component, indexed by
+   entity. The per tick updates are passes over a few float arrays, and the
+   renderer reads the store with one linear scan. The arrays have a fixed
+   size so a Game still copies into a snapshot without allocating.
+   The player is always entity 0 */
+
+enum EntityKind {
+  ENTITY_PLAYER,
+  ENTITY_BLOCK,    // a moving cell of the board
+  ENTITY_OBSTACLE,
+  ENTITY_COIN
+};
+
+const int shiftX = -8, shiftZ = -10;    // world position of cell (0, 0)
+
+const int maxEntities = 256;            // the player, 100 cells, 15 obstacles and 20 coins fit
+const int playerEntity = 0;
+
+struct Entities {
+  int count;
+  alignas(16) unsigned char kind[maxEntities];
+  alignas(16) int cellX[maxEntities];   // board cell
+  alignas(16) int cellZ[maxEntities];
+  alignas(16) float x[maxEntities];     // world position
+  alignas(16) float y[maxEntities];
+  alignas(16) float z[maxEntities];
+  alignas(16) float baseY[maxEntities];     // bobbing, see waveKernel()
+  alignas(16) float amplitude[maxEntities];
+  alignas(16) float phase[maxEntities];     // cycles
+  alignas(16) float speed[maxEntities];     // cycles per second
+};
+
+/* Index of the new entity at rest over cell (i, j), or -1 when full */
+int addEntity(Entities &e, int kind, int i, int j, float y) {
+  if(e.count == maxEntities) return -1;
+  int n = e.count++;
+  e.kind[n] = kind;
+  e.cellX[n] = i, e.cellZ[n] = j;
+  e.x[n] = i*2 + shiftX, e.y[n] = y, e.z[n] = j*2 + shiftZ;
+  e.baseY[n] = y;
+  e.amplitude[n] = e.phase[n] = e.speed[n] = 0;
+  return n;
+}
+
+/* Moves the last entity into slot 'n', so indices past 'n' change */
+void removeEntity(Entities &e, int n) {
+  if(n == playerEntity) return;
+  int last = --e.count;
+  e.kind[n] = e.kind[last];
+  e.cellX[n] = e.cellX[last], e.cellZ[n] = e.cellZ[last];
+  e.x[n] = e.x[last], e.y[n] = e.y[last], e.z[n] = e.z[last];
+  e.baseY[n] = e.baseY[last], e.amplitude[n] = e.amplitude[last];
+  e.phase[n] = e.phase[last], e.speed[n] = e.speed[last];
+}
+
+/* Drops every entity of 'kind', the others keep their order */
+void removeKind(Entities &e, int kind) {
+  int n = 0;
+  for(int i = 0; i < e.count; i++) {
+    if(e.kind[i] == kind && i != playerEntity) continue;
+    e.kind[n] = e.kind[i];
+    e.cellX[n] = e.cellX[i], e.cellZ[n] = e.cellZ[i];
+    e.x[n] = e.x[i], e.y[n] = e.y[i], e.z[n] = e.z[i];
+    e.baseY[n] = e.baseY[i], e.amplitude[n] = e.amplitude[i];
+    e.phase[n] = e.phase[i], e.speed[n] = e.speed[i];
+    n++;
+  }
+  e.count = n;
+}
+
+/* First entity of 'kind' on cell (i, j), or -1 */
+int findEntity(const Entities &e, int kind, int i, int j) {
+  for(int n = 0; n < e.count; n++)
+    if(e.cellX[n] == i && e.cellZ[n] == j && e.kind[n] == kind) return n;
+  return -1;
+}
+
+/* Board cells with an entity of 'kind' on them */
+Bitboard kindCells(const Entities &e, int kind) {
+  Bitboard cells = emptyBoard;
+  for(int n = 0; n < e.count; n++)
+    if(e.kind[n] == kind && e.cellX[n] >= 0 && e.cellX[n] <= 9 && e.cellZ[n] >= 0 && e.cellZ[n] <= 9) cells.set(e.cellX[n], e.cellZ[n]);
+  return cells;
+}
+
+/* Leaves one entity of 'kind' on each of 'cells' and none elsewhere. Those
+   already on one of the cells stay as they are, only the cells that change
+   add or remove an entity, new ones at rest at height 'y'. Returns the
+   index of the first one added, the new ones are the last in the store */
+int syncKind(Entities &e, int kind, const Bitboard &cells, float y) {
+  Bitboard kept = emptyBoard;
+  // Backwards, removeEntity() fills 'n' from the end, which was seen already
+  for(int n = e.count - 1; n > playerEntity; n--) {
+    if(e.kind[n] != kind) continue;
+    int i = e.cellX[n], j = e.cellZ[n];
+    if(i >= 0 && i <= 9 && j >= 0 && j <= 9 && cells.test(i, j) && !kept.test(i, j)) kept.set(i, j);
+    else removeEntity(e, n);
+  }
+  Bitboard added = andNot(cells, kept);
+  int first = e.count;
+  for(int i = 0; i < 10; i++) for(int j = 0; j < 10; j++)
+    if(added.test(i, j) && addEntity(e, kind, i, j, y) < 0) return first;
+  return first;
+}
+
+/* Every bobbing entity rises and falls linearly between baseY - amplitude
+   and baseY + amplitude, a triangle wave of the simulation time, at the top
+   when phase + speed * time is whole. Height is a pure function of time, so
+   blocks never drift and a snapshot can be evaluated at any time.
+
+   The kernel works on packed arrays, four entities per SSE2 instruction,
+   and does not care how many there are */
+void waveKernel(const float *baseY, const float *amplitude, const float *phase, const float *speed, float *y, int count, float time) {
+  int n = 0;
+#ifdef __SSE2__
+  __m128 t = _mm_set1_ps(time), four = _mm_set1_ps(4), two = _mm_set1_ps(2), one = _mm_set1_ps(1);
+  __m128 sign = _mm_set1_ps(-0.0f);
+  for(; n + 4 <= count; n += 4) {
+    __m128 f = _mm_add_ps(_mm_loadu_ps(phase + n), _mm_mul_ps(_mm_loadu_ps(speed + n), t));
+    f = _mm_sub_ps(f, _mm_cvtepi32_ps(_mm_cvttps_epi32(f))); // fraction, f is never negative
+    __m128 wave = _mm_sub_ps(_mm_andnot_ps(sign, _mm_sub_ps(_mm_mul_ps(four, f), two)), one);
+    _mm_storeu_ps(y + n, _mm_add_ps(_mm_loadu_ps(baseY + n), _mm_mul_ps(_mm_loadu_ps(amplitude + n), wave)));
+  }
+#endif
+  for(; n < count; n++) {
+    float f = phase[n] + speed[n] * time;
+    f -= (int)f;
+    y[n] = baseY[n] + amplitude[n] * (fabsf(4*f - 2) - 1);
+  }
+}
+
+/* Height of entity 'n' at 'time', one lane of waveKernel() */
+float waveAt(const Entities &e, int n, double time) {
+  float f = e.phase[n] + e.speed[n] * (float)time;
+  f -= (int)f;
+  return e.baseY[n] + e.amplitude[n] * (fabsf(4*f - 2) - 1);
+}
+
+/* Heights of everything but the player, whose height belongs to the rules */
+void moveEntities(Entities &e, double time) {
+  int first = playerEntity + 1;
+  waveKernel(e.baseY + first, e.amplitude + first, e.phase + first, e.speed + first, e.y + first, e.count - first, (float)time);
+}
+
+/* Bob entity 'n' between 'low' and 'high' with 'cyclesPerSecond', starting
+   at the bottom at 'time' */
+void setWave(Entities &e, int n, float low, float high, float cyclesPerSecond, double time) {
+  e.baseY[n] = (low + high) / 2;
+  e.amplitude[n] = (high - low) / 2;
+  e.speed[n] = cyclesPerSecond;
+  float phase = 0.5f - (float)fmod(cyclesPerSecond * time, 1.0);
+  e.phase[n] = phase < 0 ? phase + 1 : phase;
+  e.y[n] = low;
+}
+
+/* --bench-waves: waveKernel() on 'count' packed entities with block-like
+   waves for 600 ticks, far more than a Game's store holds. Every 60th tick
+   its heights are checked against the scalar loop, which is timed too */
+int runWaveBench(int count, unsigned seed) {
+  typedef std::chrono::steady_clock clock;
+  const int ticks = 600; // at 60 Hz
+  Rng rng;
+  rngSeed(rng, seed, 6);
+  vector<float> baseY(count), amplitude(count), phase(count), speed(count), y(count), scalar(count);
+  for(int n = 0; n < count; n++) {
+    float top = 1 + rngBelow(rng, 101) / 100.0f;
+    baseY[n] = (top - 1) / 2;
+    amplitude[n] = (top + 1) / 2;
+    phase[n] = rngBelow(rng, 1000) / 1000.0f;
+    speed[n] = 1 / (7 + rngBelow(rng, 501) / 100.0f);
+  }
+
+  double kernelTime = 0, scalarTime = 0;
+  float worst = 0;
+  long mismatches = 0;
+  for(int t = 1; t <= ticks; t++) {
+    float time = t / 60.0f;
+    clock::time_point start = clock::now();
+    waveKernel(&baseY[0], &amplitude[0], &phase[0], &speed[0], &y[0], count, time);
+    kernelTime += std::chrono::duration<double>(clock::now() - start).count();
+
+    if(t % 60) continue;
+    start = clock::now();
+    for(int n = 0; n < count; n++) {
+      float f = phase[n] + speed[n] * time;
+      f -= (int)f;
+      scalar[n] = baseY[n] + amplitude[n] * (fabsf(4*f - 2) - 1);
+    }
+    scalarTime += std::chrono::duration<double>(clock::now() - start).count();
+    for(int n = 0; n < count; n++) {
+      float d = fabsf(y[n] - scalar[n]);
+      worst = max(worst, d);
+      if(d > 1e-5f) mismatches++;
+    }
+  }
+
+#ifdef __SSE2__
+  const char *path = "SSE2";
+#else
+  const char *path = "scalar";
+#endif
+  printf("%d entities, %d ticks, %s kernel\n", count, ticks, path);
+  printf("Kernel: %.1f us per tick, %.2f ns per entity\n", kernelTime / ticks * 1e6, kernelTime / ticks / max(count, 1) * 1e9);
+  printf("Scalar loop: %.1f us per tick\n", scalarTime / (ticks / 60) * 1e6);
+  printf("Against the scalar loop: %ld mismatches, largest difference %g\n", mismatches, worst);
+  return mismatches ? 1 : 0;
+}
+
+/* A block for every moving cell of a new board. Each gets its own phase,
+   speed (a cycle in 7 to 12 s) and height (1 to 2 at the top, -1 at the
+   bottom) from 'rng' */
+void placeBlocks(Entities &e, const Bitboard &isMoving, Rng &rng) {
+  removeKind(e, ENTITY_BLOCK);
+  for(int i = 0; i < 10; i++) for(int j = 0; j < 10; j++) {
+    if(!isMoving.test(i, j)) continue;
+    int n = addEntity(e, ENTITY_BLOCK, i, j, -1);
+    if(n < 0) return;
+    float top = 1 + rngBelow(rng, 101) / 100.0f;
+    e.baseY[n] = (top - 1) / 2;
+    e.amplitude[n] = (top + 1) / 2;
+    e.phase[n] = rngBelow(rng, 1000) / 1000.0f;
+    e.speed[n] = 1 / (7 + rngBelow(rng, 501) / 100.0f);
+  }
+}
+
+/* The player on cell (0, 0) and the blocks of the first board */
+Entities startEntities(const Bitboard &isMoving) {
+  Entities e = Entities(); // zeroed
+  Rng rng;
+  rngSeed(rng, 0, 4);
+  addEntity(e, ENTITY_PLAYER, 0, 0, 4.2);
+  placeBlocks(e, isMoving, rng);
+  return e;
+}
+
+#endif
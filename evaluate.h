@@ -0,0 +1,202 @@
+#ifndef EVALUATE_H
+#define EVALUATE_H
+
+#include <algorithm>
+#include "game.h"
+#include "bot.h"
+#include "threads.h"
+
+/* Batch difficulty evaluation for tuning the board densities: thousands of
+   boards per level are played by a Bot through the headless rules on every
+   core, and the survival rate, time to the goal and coins picked up are
+   printed per level, for each point of a grid of densities.
+
+   The soak test leaves hundreds of bots playing whole games, menu and game
+   overs included, to time the bots and catch boards they never finish */
+
+const double evaluateTimeLimit = 120; // simulated seconds before a run counts as lost
+const int evaluateChunk = 64;         // boards per pool job
+const double soakTime = 600;          // simulated seconds per bot in --soak
+
+struct BoardRun {
+  bool reached;   // got to the goal with lives left, inside the time limit
+  float time;     // seconds to the goal
+  int coins;
+  int livesLost;
+};
+
+/* One bot playing board 'number' at 'level' from a fresh game */
+BoardRun runBoard(unsigned seed, long number, int level, const BoardDensity &density) {
+  PreparedBoard b;
+  prepareBoard(seed, number, level, b, density);
+  Game g;
+  seedGame(g, seed + number);
+  g.level = level;
+  g.onMenu = false;
+  useBoard(g, b);
+
+  Bot bot;
+  BoardRun run = { false, 0, 0, 0 };
+  int points = g.points, lives = g.lives;
+  while(!g.playerWin && !g.playerLose && g.time < evaluateTimeLimit) {
+    botTick(bot, g);
+    stepGame(g);
+    if(g.points > points) run.coins += (g.points - points) / 20;
+    if(g.lives < lives) run.livesLost += lives - g.lives;
+    points = g.points, lives = g.lives;
+  }
+  run.reached = g.playerWin;
+  run.time = g.currentTime;
+  return run;
+}
+
+/* Comma separated numbers, as given to --hole-odds and --moving-odds */
+vector<int> parseList(const char *s) {
+  vector<int> list;
+  char *end;
+  for(long v = strtol(s, &end, 10); end != s; v = strtol(s, &end, 10)) {
+    list.push_back((int)v);
+    s = *end == ',' ? end + 1 : end;
+  }
+  return list;
+}
+
+/* p in [0, 1] of a sorted list */
+float percentile(const vector<float> &sorted, float p) {
+  if(sorted.empty()) return 0;
+  return sorted[(int)(p * (sorted.size() - 1) + 0.5f)];
+}
+
+void printLevelStats(const BoardDensity &density, int level, const vector<BoardRun> &runs) {
+  vector<float> times, coins;
+  int reached = 0;
+  float livesLost = 0;
+  for(int i = 0; i < runs.size(); i++) {
+    if(runs[i].reached) reached++, times.push_back(runs[i].time);
+    coins.push_back(runs[i].coins);
+    livesLost += runs[i].livesLost;
+  }
+  sort(times.begin(), times.end());
+  sort(coins.begin(), coins.end());
+  float coinsMean = 0;
+  for(int i = 0; i < coins.size(); i++) coinsMean += coins[i];
+  if(!coins.empty()) coinsMean /= coins.size();
+  printf("%5d %6d %5d %6d %7.1f%% %6.1f %6.1f %6.1f %9.2f %4.0f %4.0f %4.0f %10.2f\n",
+         density.holes, density.moving, level, (int)runs.size(), 100.0f * reached / max((int)runs.size(), 1),
+         percentile(times, 0.1f), percentile(times, 0.5f), percentile(times, 0.9f),
+         coinsMean, percentile(coins, 0.1f), percentile(coins, 0.5f), percentile(coins, 0.9f),
+         livesLost / max((int)runs.size(), 1));
+}
+
+/* Plays 'boards' boards at each of levels 1..'levels' for every pair of
+   hole and moving odds */
+int runEvaluation(unsigned seed, int boards, int levels, const vector<int> &holeOdds, const vector<int> &movingOdds) {
+  vector<BoardDensity> grid;
+  for(int i = 0; i < holeOdds.size(); i++) for(int j = 0; j < movingOdds.size(); j++) {
+    BoardDensity d;
+    d.holes = holeOdds[i];
+    d.moving = movingOdds[j];
+    grid.push_back(d);
+  }
+  if(grid.empty() || boards <= 0 || levels <= 0) {
+    cout << "Nothing to evaluate" << endl;
+    return 1;
+  }
+  reportLevels = false;
+
+  // runs[cell][board], cell is density * levels + level - 1. Every job
+  // writes its own range, so the pool needs no locking
+  vector< vector<BoardRun> > runs(grid.size() * levels, vector<BoardRun>(boards));
+  ThreadPool pool;
+  startPool(pool, 0);
+  double start = inputClock();
+  for(int d = 0; d < grid.size(); d++) for(int level = 1; level <= levels; level++) {
+    for(int first = 0; first < boards; first += evaluateChunk) {
+      vector<BoardRun> *cell = &runs[d * levels + level - 1];
+      BoardDensity density = grid[d];
+      submit(pool, [=] {
+        for(int k = first; k < min(first + evaluateChunk, boards); k++) (*cell)[k] = runBoard(seed, k, level, density);
+      });
+    }
+  }
+  stopPool(pool);
+  double elapsed = inputClock() - start;
+
+  printf("Seed %u, %d boards per level, %.1f s limit\n", seed, boards, evaluateTimeLimit);
+  printf("%5s %6s %5s %6s %8s %20s %24s %6s\n", "holes", "moving", "level", "boards", "survival", "goal s p10/p50/p90", "coins mean p10/p50/p90", "lives lost");
+  for(int d = 0; d < grid.size(); d++) for(int level = 1; level <= levels; level++)
+    printLevelStats(grid[d], level, runs[d * levels + level - 1]);
+  printf("Played %ld boards in %.1f s\n", (long)runs.size() * boards, elapsed);
+  return 0;
+}
+
+struct SoakRun {
+  long ticks;
+  long plans;
+  double botSeconds;  // spent in botTick()
+  int boards;         // goals reached
+  int livesLost;
+  int gamesLost;
+  int topLevel;
+  double longest;     // longest time on one board
+};
+
+/* Bot 'n' playing from the menu for soakTime simulated seconds */
+SoakRun soakGame(unsigned seed, int n) {
+  Game g;
+  seedGame(g, seed + n);
+  Bot bot;
+  bot.house = 1 + n % 9;
+  SoakRun run = { 0, 0, 0, 0, 0, 0, 1, 0 };
+  bool won = false, lost = false;
+  int lives = g.lives;
+  while(g.time < soakTime) {
+    double start = inputClock();
+    botTick(bot, g);
+    run.botSeconds += inputClock() - start;
+    stepGame(g);
+    run.ticks++;
+    if(g.playerWin && !won) run.boards++;
+    if(g.playerLose && !lost) run.gamesLost++;
+    if(g.lives < lives) run.livesLost += lives - g.lives;
+    won = g.playerWin, lost = g.playerLose, lives = g.lives;
+    run.topLevel = max(run.topLevel, g.level);
+    if(!g.onMenu && !g.playerWin) run.longest = max(run.longest, g.currentTime);
+  }
+  run.plans = bot.plans;
+  return run;
+}
+
+/* --soak: 'bots' games at once on every core. Fails when a bot spent
+   longer than evaluateTimeLimit on a board */
+int runSoak(unsigned seed, int bots) {
+  reportLevels = false;
+  vector<SoakRun> runs(bots);
+  ThreadPool pool;
+  startPool(pool, 0);
+  double start = inputClock();
+  for(int n = 0; n < bots; n++) {
+    SoakRun *run = &runs[n];
+    submit(pool, [=] { *run = soakGame(seed, n); });
+  }
+  stopPool(pool);
+  double elapsed = inputClock() - start;
+
+  SoakRun total = { 0, 0, 0, 0, 0, 0, 1, 0 };
+  int stalled = 0;
+  for(int n = 0; n < bots; n++) {
+    total.ticks += runs[n].ticks, total.plans += runs[n].plans, total.botSeconds += runs[n].botSeconds;
+    total.boards += runs[n].boards, total.livesLost += runs[n].livesLost, total.gamesLost += runs[n].gamesLost;
+    total.topLevel = max(total.topLevel, runs[n].topLevel);
+    total.longest = max(total.longest, runs[n].longest);
+    if(runs[n].longest > evaluateTimeLimit) stalled++;
+  }
+  printf("Seed %u, %d bots for %.0f s each\n", seed, bots, soakTime);
+  printf("%ld ticks in %.1f s, %.0f ticks/s\n", total.ticks, elapsed, total.ticks / elapsed);
+  printf("Bots: %.2f us per tick, %.2f us per plan, %ld plans\n", total.botSeconds / max(total.ticks, 1L) * 1e6, total.botSeconds / max(total.plans, 1L) * 1e6, total.plans);
+  printf("%d goals reached, top level %d, %d lives and %d games lost\n", total.boards, total.topLevel, total.livesLost, total.gamesLost);
+  printf("Longest on one board %.1f s, %d bots over %.0f s\n", total.longest, stalled, evaluateTimeLimit);
+  return stalled ? 1 : 0;
+}
+
+#endif
@@ -0,0 +1,466 @@
+#ifndef GAME_H
+#define GAME_H
+
+#include "rng.h"
+#include "levels.h"
+#include "entities.h"
+#include "sweep.h"
+#include "timers.h"
+
+/* Board and player rules. Everything the simulation changes lives in a Game,
+   so a whole game can be copied into a snapshot for the renderer. Nothing in
+   here calls GL or GLFW, time is the simulation clock g.time */
+
+int tickRate = 60;              // --tick-rate, the rules were tuned for 60 Hz vsync
+double tickLength = 1.0 / tickRate;
+float tickScale = 1;            // the per tick distances below are for 60 Hz
+
+/* Ticks per second of every game, set before one is started. Delays are in
+   seconds and distances scale with the tick, so a game plays the same at
+   any rate, only coarser */
+void setTickRate(int rate) {
+  tickRate = rate;
+  tickLength = 1.0 / rate;
+  tickScale = tickLength * 60;
+}
+
+/* The board shown before a kingdom is picked */
+const bool initialPresent[10][10] = {
+  1, 1, 1, 1, 1, 1, 1, 1, 1, 1,
+  1, 1, 0, 1, 0, 1, 1, 1, 1, 0,
+  0, 1, 1, 1, 1, 1, 0, 1, 0, 1,
+  1, 1, 1, 1, 1, 0, 1, 1, 1, 1,
+  1, 1, 0, 1, 1, 1, 1, 1, 1, 1,
+  1, 1, 1, 1, 0, 1, 1, 0, 1, 1,
+  0, 1, 1, 0, 1, 0, 1, 1, 1, 1,
+  0, 1, 1, 0, 1, 1, 0, 1, 1, 1,
+  1, 0, 1, 1, 1, 0, 1, 0, 1, 1,
+  1, 1, 1, 0, 1, 1, 1, 1, 0, 1
+};
+
+const bool initialMoving[10][10] = {
+  0, 0, 0, 0, 0, 1, 0, 0, 0, 0,
+  0, 0, 0, 0, 0, 0, 0, 1, 0, 0,
+  0, 0, 0, 0, 0, 0, 0, 0, 0, 0,
+  0, 0, 0, 0, 0, 0, 0, 0, 0, 0,
+  0, 0, 0, 0, 0, 0, 1, 0, 0, 1,
+  0, 0, 0, 0, 0, 0, 0, 0, 0, 0,
+  0, 1, 0, 0, 0, 0, 0, 0, 0, 0,
+  0, 0, 0, 0, 0, 0, 0, 0, 0, 0,
+  0, 0, 0, 0, 0, 0, 0, 0, 0, 0,
+  0, 0, 0, 0, 0, 0, 1, 0, 0, 0
+};
+
+/* Game events on g.timers, see timerEvents */
+enum TimerEvent { TIMER_RESPAWN, TIMER_MAGIC_LIFE, TIMER_BLINK, TIMER_NEXT_BOARD, TIMER_GAME_OVER, NUM_TIMER_EVENTS };
+
+const double respawnTime = 200 / 60.0; // seconds, new obstacles and coins this often
+const double magicLifeEvery = 3; // seconds between chances of a life on a diagonal
+const double blinkTime = 2.5;     // seconds the player blinks after a hit
+const double winDelay = 5, loseDelay = 4; // seconds before the next board or the menu
+
+struct Game {
+  double time = 0;  // simulation clock, seconds
+  long tick = 0;
+
+  unsigned seed = 1;
+  long boardsDrawn = 0;              // boards come from prepareBoard(seed, boardsDrawn, level)
+  Rng spawnRng, rewardRng, motionRng; // see seedGame()
+
+  float animateX = -10;
+  float animateY = 3;
+
+  bool starAnimate = false, heartAnimate = false, onMenu = true;
+  int playerHouse = 0;
+  float speed = 1;
+
+  double currentTime = 0;             // on this board, stops when it is won
+  TimerWheel timers = startTimers(0); // on g.tick, every delay of the rules
+
+  int level = 1;
+  int optimalMoves = -1; // fewest moves to the goal on this board, from solveBoard()
+  float difficulty = 0;
+
+  int lives = 3, points = 0;
+  int prevPlayerX = 0, prevPlayerZ = 0;
+
+  bool playerJumpUp = false, playerJumpDown = false, playerJumpRight = false, playerJumpLeft = false;
+  bool playerMoveUp = false, playerMoveDown = false, playerMoveRight = false, playerMoveLeft = false;
+  bool playerWin = false, playerLose = false;
+  int playerDirection = 3;
+
+  bool playerFall = false, playerFallOff = false, playerAnimate = false;
+  bool jumpHeld = false; // space bar, see applyInput()
+
+  Bitboard isPresent = boardFromCells(initialPresent);
+  Bitboard isMoving = boardFromCells(initialMoving);
+
+  Entities entities = startEntities(isMoving); // the player's position, blocks, obstacles and coins
+};
+
+/* Each subsystem has its own stream, so a change to how often one of them
+   draws does not shift the others. Boards get a stream each, see
+   prepareBoard(). Equal seeds give equal games */
+void seedGame(Game &g, unsigned seed) {
+  g.seed = seed;
+  rngSeed(g.spawnRng, seed, 2);
+  rngSeed(g.rewardRng, seed, 3);
+  rngSeed(g.motionRng, seed, 4);
+}
+
+bool reportLevels = true;    // print each level's optimal move count
+
+/* Event 'timer' in 'seconds' of simulation time, in place of a pending one */
+void schedule(Game &g, int timer, double seconds) {
+  scheduleTimer(g.timers, timer, g.tick + lround(seconds * tickRate));
+}
+
+/* Puts board 'b' in play, with a block on each of its moving cells */
+void useBoard(Game &g, const PreparedBoard &b) {
+  g.isPresent = b.isPresent;
+  g.isMoving = b.isMoving;
+  g.optimalMoves = b.optimalMoves;
+  g.difficulty = b.difficulty;
+  placeBlocks(g.entities, g.isMoving, g.motionRng);
+  // Obstacles and coins for it on the next tick
+  scheduleTimer(g.timers, TIMER_RESPAWN, g.tick + 1);
+  if(timerDue(g.timers, TIMER_MAGIC_LIFE) < 0) schedule(g, TIMER_MAGIC_LIFE, magicLifeEvery);
+}
+
+/* Swaps in the next board, prepared in the background when the level
+   pipeline runs, and queues the ones that may follow it */
+void boardReset(Game &g) {
+  PreparedBoard b;
+  g.boardsDrawn++;
+  if(!takePreparedBoard(g.seed, g.boardsDrawn, g.level, b)) prepareBoard(g.seed, g.boardsDrawn, g.level, b);
+  useBoard(g, b);
+  prefetchBoards(g.seed, g.boardsDrawn, g.level);
+
+  if(reportLevels) printf("Level %d: goal in %d moves, difficulty %.1f%s\n", g.level, g.optimalMoves, g.difficulty, b.repaired ? " (repaired)" : "");
+}
+
+/* The state of a game as the renderer sees it, from the rule flags. The
+   rules keep the flags, they are what replays and snapshots carry */
+enum GameState { STATE_MENU, STATE_PLAYING, STATE_DYING, STATE_WON, STATE_LOST, NUM_GAME_STATES };
+
+int gameState(const Game &g) {
+  if(g.onMenu) return STATE_MENU;
+  if(g.playerLose) return STATE_LOST;
+  if(g.playerWin) return STATE_WON;
+  if(g.playerAnimate || g.playerFall || g.playerFallOff) return STATE_DYING;
+  return STATE_PLAYING;
+}
+
+/* Back to the start cell, shared by the resets below */
+void playerStart(Game &g) {
+  Entities &e = g.entities;
+  const int p = playerEntity;
+  g.playerFall = false, g.playerFallOff = false;
+  e.cellX[p] = 0;
+  e.cellZ[p] = 0;
+  e.y[p] = 4.2;
+  e.x[p] = shiftX;
+  e.z[p] = shiftZ;
+  g.playerJumpRight = g.playerJumpUp = g.playerJumpLeft = g.playerJumpDown = false;
+  g.playerDirection = 3;
+}
+
+void gameReset(Game &g) {
+  g.level++;
+  g.points+=100;
+
+  boardReset(g);
+
+  g.playerLose = false;
+
+  g.currentTime = 0;
+  g.playerWin = false;
+  playerStart(g);
+  g.playerMoveDown = g.playerMoveLeft = g.playerMoveRight = g.playerMoveUp = false;
+}
+
+void gameResetAfterLoss(Game &g) {
+  boardReset(g);
+
+  g.playerLose = false;
+  g.points = 0;
+  g.level = 1;
+  g.lives = 3;
+
+  g.currentTime = 0;
+  g.playerWin = false;
+  playerStart(g);
+  g.playerMoveDown = g.playerMoveLeft = g.playerMoveRight = g.playerMoveUp = false;
+  g.onMenu = true;
+}
+
+void magicLife(Game &g) {
+  Entities &e = g.entities;
+  const int p = playerEntity;
+  if(!(e.cellX[p]==e.cellZ[p] or e.cellZ[p]+e.cellX[p] == 9)) return;
+  int temp = rngBelow(g.rewardRng, 100);
+  if(temp == 0) g.lives++;
+}
+
+/* Cell under the player's current coordinates, the same cells as
+   sweepCells() sees. Off the board it is left alone for updatePos() */
+void updateCell(Game &g) {
+  Entities &e = g.entities;
+  const int p = playerEntity;
+  int i = cellOf(e.x[p], shiftX), j = cellOf(e.z[p], shiftZ);
+  if(i >= 0 && i <= 9 && j >= 0 && j <= 9) e.cellX[p] = i, e.cellZ[p] = j;
+}
+
+void updatePos(Game &g) {
+  Entities &e = g.entities;
+  const int p = playerEntity;
+  updateCell(g);
+  if(e.cellX[p] == 9 && e.cellZ[p] == 9) {
+    if(!g.playerWin) schedule(g, TIMER_NEXT_BOARD, winDelay);
+    g.playerWin = true;
+  }
+  else if(e.x[p] < shiftX - 1) g.playerFallOff = true, e.cellX[p] = -1;
+  else if(e.x[p] >= 9*2+shiftX + 2) g.playerFallOff = true, e.cellX[p] = 10;
+  else if(e.z[p] < shiftZ - 2) g.playerFallOff = true, e.cellZ[p] = -1;
+  else if(e.z[p] >= 9*2+shiftZ +2) g.playerFallOff = true, e.cellZ[p] = 10;
+}
+
+
+void playerReset(Game &g, int f = 1) {
+  if(!g.playerFall && !g.playerAnimate && f!=2) {
+    schedule(g, TIMER_BLINK, blinkTime);
+    g.playerAnimate = true;
+  }
+  if(g.playerAnimate) return;
+
+  if(!g.playerLose) g.lives--;
+
+  g.heartAnimate = true;
+  if(g.lives==0) {
+    g.level = 1;
+    g.points = 0;
+
+    if(!g.playerLose) schedule(g, TIMER_GAME_OVER, loseDelay);
+    g.playerLose = true;
+    return;
+  }
+
+  playerStart(g);
+}
+
+
+/* Height of the moving block on cell (i, j), 0 for a still cell */
+float blockHeight(const Game &g, int i, int j) {
+  int n = findEntity(g.entities, ENTITY_BLOCK, i, j);
+  return n < 0 ? 0 : g.entities.y[n];
+}
+
+void checkCollision(Game &g) {
+  Entities &e = g.entities;
+  const int p = playerEntity;
+  if(findEntity(e, ENTITY_OBSTACLE, e.cellX[p], e.cellZ[p]) >= 0) playerReset(g);
+  int coin = findEntity(e, ENTITY_COIN, e.cellX[p], e.cellZ[p]);
+  if(coin >= 0) {
+    g.points += 20;
+    g.starAnimate = true;
+    for(; coin >= 0; coin = findEntity(e, ENTITY_COIN, e.cellX[p], e.cellZ[p])) removeEntity(e, coin);
+  }
+  bool jumping = g.playerJumpUp || g.playerJumpDown || g.playerJumpRight || g.playerJumpLeft;
+  if(g.isPresent.test(e.cellX[p], e.cellZ[p]) == 0 && !jumping) g.playerFall = true;
+  if(g.isMoving.test(e.cellX[p], e.cellZ[p]) && e.y[p] - 1 <= blockHeight(g, e.cellX[p], e.cellZ[p]) + 3 and !g.playerLose) playerReset(g);
+  else if(g.isMoving.test(e.cellX[p], e.cellZ[p]) && !jumping and !g.playerLose) playerReset(g);
+}
+
+/* Runs checkCollision() on every cell the player crossed coming from
+   (x0, z0), but the last one, which the caller checks as before. A step of
+   more than a cell, at a high speed or a long tick, skips no hole,
+   obstacle or coin. The player stops on the first cell that ends the move,
+   where it fell or was hit, and true is returned */
+bool sweepPlayer(Game &g, float x0, float z0) {
+  Entities &e = g.entities;
+  const int p = playerEntity;
+  int cells[32][2];
+  int n = sweepCells(x0, z0, e.x[p], e.z[p], cells, 32);
+  for(int k = 0; k + 1 < n; k++) {
+    int i = cells[k][0], j = cells[k][1];
+    if(i < 0 || i > 9 || j < 0 || j > 9) return false; // going off the board, updatePos() sees to it
+    e.cellX[p] = i, e.cellZ[p] = j;
+    checkCollision(g);
+    if(g.playerFall || g.playerAnimate) {
+      e.x[p] = i*2+shiftX, e.z[p] = j*2+shiftZ;
+      return true;
+    }
+  }
+  return false;
+}
+
+/* The new cells are drawn first, then only the cells that differ from the
+   last ones change in the store. Obstacles on a cell drawn again stay as
+   they are, new ones start to bob from the bottom */
+void genObstacles(Game &g) {
+  Entities &e = g.entities;
+  const int p = playerEntity;
+  Bitboard coins = kindCells(e, ENTITY_COIN), cells = emptyBoard;
+  int r, c;
+  for(int i=0; i<15; i++) {
+    r = rngBelow(g.spawnRng, 10);
+    c = rngBelow(g.spawnRng, 10);
+    if(!(r==9&&c==9) && !(r==0&&c==0) && g.isPresent.test(r, c) && !g.isMoving.test(r, c) && !(e.cellX[p] == r && e.cellZ[p] == c) && !coins.test(r, c))
+      cells.set(r, c);
+  }
+  for(int n = syncKind(e, ENTITY_OBSTACLE, cells, 4); n < e.count; n++) setWave(e, n, 4, 5, 0.3, g.time);
+}
+
+void genCoins(Game &g) {
+  Entities &e = g.entities;
+  const int p = playerEntity;
+  Bitboard obstacles = kindCells(e, ENTITY_OBSTACLE), cells = emptyBoard;
+  int r, c;
+  for(int i=0; i<20; i++) {
+    r = rngBelow(g.spawnRng, 10);
+    c = rngBelow(g.spawnRng, 10);
+    if(g.isPresent.test(r, c) && !g.isMoving.test(r, c) && !(e.cellX[p] == r && e.cellZ[p] == c) && !obstacles.test(r, c))
+      cells.set(r, c);
+  }
+  syncKind(e, ENTITY_COIN, cells, 4.2);
+}
+
+
+void drawFall(Game &g) {
+  Entities &e = g.entities;
+  const int p = playerEntity;
+  if(g.playerFallOff && e.cellX[p] == -1) e.x[p] -=0.05*tickScale;
+  if(g.playerFallOff && e.cellZ[p] == 10) e.z[p] +=0.05*tickScale;
+  if(g.playerFallOff && e.cellZ[p] == -1) e.z[p] -=0.05*tickScale;
+  if(g.playerFallOff && e.cellX[p] == 10) e.x[p] +=0.05*tickScale;
+
+  if(g.playerFall) {
+    e.y[p] -= 0.1*tickScale;
+  }
+  if(e.y[p] <= -10) {
+    playerReset(g);
+  }
+}
+
+void drawJump(Game &g) {
+  Entities &e = g.entities;
+  const int p = playerEntity;
+  if(g.playerAnimate) return;
+  float x0 = e.x[p], z0 = e.z[p];
+  double step = 0.05*tickScale;
+  float  fixed = step;
+  if(e.x[p] >= 2*g.prevPlayerX+shiftX+2 and fixed>0) fixed*=-1;
+  if(e.z[p] >= g.prevPlayerZ*2+2+shiftZ and fixed>0) fixed*=-1;
+  if(e.x[p] <= 2*g.prevPlayerX+shiftX-2 and fixed>0) fixed*=-1;
+  if(e.z[p] <= 2*g.prevPlayerZ+shiftZ-2 and fixed>0) fixed*=-1;
+  if(g.playerJumpUp) {
+    e.x[p] += step;
+    e.y[p] += fixed;
+    if(e.y[p]<4.2 && !g.playerFall) e.y[p] = 4.2;
+  }
+  else if(g.playerJumpDown) {
+    e.x[p] -= step;
+    e.y[p] += fixed;
+    if(e.y[p]<4.2 && !g.playerFall) e.y[p] = 4.2;
+  }
+  else if(g.playerJumpRight) {
+    e.z[p] += step;
+    e.y[p] += fixed;
+    if(e.y[p]<4.2 && !g.playerFall) e.y[p] = 4.2;
+  }
+  else if(g.playerJumpLeft) {
+    e.z[p] -= step;
+    e.y[p] += fixed;
+    if(e.y[p]<4.2 && !g.playerFall) e.y[p] = 4.2;
+  }
+  if(sweepPlayer(g, x0, z0)) return;
+  updatePos(g);
+  // Land two cells on, a long tick may have carried the player past the centre
+  if(e.x[p] >= 2*g.prevPlayerX+shiftX+4 && g.playerJumpUp) e.x[p] = 2*(g.prevPlayerX+2)+shiftX, e.cellX[p] = g.prevPlayerX+2, e.y[p] = 4.2, g.playerJumpUp = false;
+  if(e.z[p] >= g.prevPlayerZ*2+shiftZ+4 && g.playerJumpRight) e.z[p] = 2*(g.prevPlayerZ+2)+shiftZ, e.cellZ[p] = g.prevPlayerZ+2, e.y[p] = 4.2, g.playerJumpRight = false;
+  if(e.x[p] <= 2*g.prevPlayerX+shiftX-4 && g.playerJumpDown) e.x[p] = 2*(g.prevPlayerX-2)+shiftX, e.cellX[p] = g.prevPlayerX-2, e.y[p] = 4.2, g.playerJumpDown = false;
+  if(e.z[p] <= 2*g.prevPlayerZ+shiftZ-4 && g.playerJumpLeft) e.z[p] = 2*(g.prevPlayerZ-2)+shiftZ, e.cellZ[p] = g.prevPlayerZ-2, e.y[p] = 4.2, g.playerJumpLeft = false;
+  checkCollision(g);
+}
+
+/* Timer events */
+
+void respawn(Game &g) {
+  if(g.onMenu) return; // picking a kingdom puts a board in play, which respawns
+  genObstacles(g);
+  genCoins(g);
+  schedule(g, TIMER_RESPAWN, respawnTime);
+}
+
+void magicLifeEvent(Game &g) {
+  if(!g.onMenu && !g.playerAnimate) magicLife(g);
+  schedule(g, TIMER_MAGIC_LIFE, magicLifeEvery);
+}
+
+/* Blinking after a hit is over, the player restarts */
+void blinkEnd(Game &g) {
+  g.playerAnimate = false;
+  playerReset(g, 2);
+}
+
+void (*const timerEvents[NUM_TIMER_EVENTS])(Game &g) = {
+  respawn, magicLifeEvent, blinkEnd, gameReset, gameResetAfterLoss
+};
+
+void drawMove(Game &g) {
+  Entities &e = g.entities;
+  const int p = playerEntity;
+  if(g.playerAnimate) return;
+  if(!g.playerMoveUp and !g.playerMoveLeft and !g.playerMoveRight and !g.playerMoveDown) return;
+  float x0 = e.x[p], z0 = e.z[p];
+  double step = 0.1*g.speed*tickScale;
+  if(g.playerMoveUp and !g.playerFall) e.x[p] += step;
+  else if(g.playerMoveDown and !g.playerFall) e.x[p] -= step;
+  else if(g.playerMoveRight and !g.playerFall) e.z[p] += step;
+  else if(g.playerMoveLeft and !g.playerFall) e.z[p] -= step;
+  if(sweepPlayer(g, x0, z0)) return;
+  updatePos(g);
+  if(!g.isPresent.test(e.cellX[p], e.cellZ[p]) || e.cellX[p] > 9 || e.cellX[p] < 0 || e.cellZ[p] > 9 || e.cellZ[p] < 0) {
+    g.playerFall = true;
+    if(!g.isPresent.test(e.cellX[p], e.cellZ[p])) {
+      e.x[p] = e.cellX[p]*2+shiftX;
+      e.z[p] = e.cellZ[p]*2+shiftZ;
+    }
+  }
+  checkCollision(g);
+}
+
+/* Star or heart flying across the HUD after a pickup or a lost life */
+void updateAnimate(Game &g) {
+  g.animateX += 0.1*tickScale;
+  if(g.animateX >= 10) {
+    g.starAnimate = g.heartAnimate = false;
+    g.animateX = -10, g.animateY = 3;
+    return;
+  }
+  if(g.animateX<0) g.animateY += 0.015*tickScale;
+  else g.animateY -= 0.015*tickScale;
+}
+
+/* Advance 'g' by one tick of tickLength seconds */
+void stepGame(Game &g) {
+  g.tick++;
+  g.time += tickLength;
+
+  int fired[maxTimers];
+  int n = advanceTimers(g.timers, fired);
+  for(int k = 0; k < n; k++) timerEvents[fired[k]](g);
+
+  moveEntities(g.entities, g.time); // obstacles and moving blocks
+
+  if(g.onMenu == false) {
+    drawFall(g);
+    drawJump(g);
+    drawMove(g);
+    if(g.starAnimate || g.heartAnimate) updateAnimate(g);
+  }
+
+  if(!g.playerWin) g.currentTime += tickLength;
+}
+
+#endif
@@ -0,0 +1,146 @@
+#ifndef INPUT_H
+#define INPUT_H
+
+#include <atomic>
+#include <chrono>
+#include "game.h"
+
+/* Keyboard input reaches the simulation as timestamped events. GLFW
+   callbacks push them into a single producer / single consumer ring and the
+   simulation applies them at the start of the tick they arrived in, so the
+   rules never read input state from another thread */
+
+enum InputKey {
+  INPUT_UP,
+  INPUT_DOWN,
+  INPUT_RIGHT,
+  INPUT_LEFT,
+  INPUT_JUMP,    // held together with an arrow key
+  INPUT_FASTER,
+  INPUT_SLOWER,
+  INPUT_HOUSE1,  // INPUT_HOUSE1 .. INPUT_HOUSE1+8 pick a kingdom on the menu
+  NUM_INPUT_KEYS = INPUT_HOUSE1 + 9
+};
+
+struct InputEvent {
+  double time;   // inputClock() when the callback ran
+  unsigned char key;
+  bool press;    // false for a release
+  bool relative; // arrows turn the player instead of moving along the board (follow views)
+};
+
+/* Seconds on the clock shared by the callbacks and the simulation thread */
+double inputClock() {
+  return std::chrono::duration<double>(std::chrono::steady_clock::now().time_since_epoch()).count();
+}
+
+/* Lock-free ring, one thread pushes and one pops. N must be a power of two */
+template <typename T, unsigned N> struct SpscQueue {
+  T items[N];
+  alignas(64) std::atomic<unsigned> head{0}; // next to pop, written by the consumer
+  alignas(64) std::atomic<unsigned> tail{0}; // next to push, written by the producer
+
+  bool push(const T &item) {
+    unsigned t = tail.load(std::memory_order_relaxed);
+    if(t - head.load(std::memory_order_acquire) == N) return false; // full
+    items[t & (N - 1)] = item;
+    tail.store(t + 1, std::memory_order_release);
+    return true;
+  }
+
+  /* Oldest item, or NULL when empty */
+  T *front() {
+    unsigned h = head.load(std::memory_order_relaxed);
+    if(h == tail.load(std::memory_order_acquire)) return NULL;
+    return &items[h & (N - 1)];
+  }
+
+  void pop() {
+    head.store(head.load(std::memory_order_relaxed) + 1, std::memory_order_release);
+  }
+};
+
+SpscQueue<InputEvent, 256> inputQueue;
+void (*onInputApplied)(const Game &g, const InputEvent &e) = NULL; // the recorder, see replay.h
+
+/* Called on the GLFW thread */
+void pushInput(int key, bool press, bool relative) {
+  InputEvent e;
+  e.time = inputClock();
+  e.key = key;
+  e.press = press;
+  e.relative = relative;
+  if(!inputQueue.push(e)) cout << "Input queue full, dropping event" << endl;
+}
+
+/* Directions are 1 up, 2 down, 3 right, 4 left */
+bool &moveFlag(Game &g, int direction) {
+  if(direction == 1) return g.playerMoveUp;
+  if(direction == 2) return g.playerMoveDown;
+  if(direction == 3) return g.playerMoveRight;
+  return g.playerMoveLeft;
+}
+
+bool &jumpFlag(Game &g, int direction) {
+  if(direction == 1) return g.playerJumpUp;
+  if(direction == 2) return g.playerJumpDown;
+  if(direction == 3) return g.playerJumpRight;
+  return g.playerJumpLeft;
+}
+
+/* Direction an arrow key leads to, [key][playerDirection] for the follow views */
+const int turnDirection[4][5] = {
+  { 0, 1, 2, 3, 4 }, // up keeps going
+  { 0, 2, 1, 4, 3 }, // down turns around
+  { 0, 3, 4, 2, 1 }, // right
+  { 0, 4, 3, 1, 2 }  // left
+};
+
+void applyInput(Game &g, const InputEvent &e) {
+  if(e.key == INPUT_JUMP) {
+    g.jumpHeld = e.press;
+    return;
+  }
+  bool arrow = e.key <= INPUT_LEFT;
+
+  if(!e.press) {
+    if(g.onMenu == true) {
+      if(e.key >= INPUT_HOUSE1 && e.key < NUM_INPUT_KEYS) {
+        g.playerHouse = e.key - INPUT_HOUSE1 + 1, g.onMenu = false;
+        boardReset(g);
+      }
+      g.currentTime = 0;
+    }
+    if(arrow) moveFlag(g, e.relative ? g.playerDirection : e.key + 1) = false;
+    else if(e.key == INPUT_FASTER && g.speed<7) g.speed += 1;
+    else if(e.key == INPUT_SLOWER && g.speed>0) g.speed -= 1;
+    return;
+  }
+
+  if(!arrow) return;
+  if(g.playerFall or g.playerJumpUp or g.playerJumpDown or g.playerJumpRight or g.playerJumpLeft or g.playerWin) return;
+  g.playerDirection = e.relative ? turnDirection[e.key][g.playerDirection] : e.key + 1;
+  if(g.jumpHeld) {
+    g.prevPlayerX = g.entities.cellX[playerEntity];
+    g.prevPlayerZ = g.entities.cellZ[playerEntity];
+    jumpFlag(g, g.playerDirection) = true;
+  }
+  else moveFlag(g, g.playerDirection) = true;
+}
+
+/* Apply the events that arrived before inputClock() value 'until' */
+void drainInput(Game &g, double until) {
+  InputEvent *e;
+  while((e = inputQueue.front()) && e->time <= until) {
+    applyInput(g, *e);
+    if(onInputApplied) onInputApplied(g, *e);
+    inputQueue.pop();
+  }
+}
+
+/* Drop keyboard input, used while a replay drives the game */
+void discardInput() {
+  while(inputQueue.front()) inputQueue.pop();
+}
+
+#endif
@@ -0,0 +1,140 @@
+#ifndef LEVELS_H
+#define LEVELS_H
+
+#include <map>
+#include <set>
+#include "rng.h"
+#include "solver.h"
+#include "threads.h"
+
+/* Boards are prepared ahead of time on worker threads. A board is a pure
+   function of the game seed, how many boards the game has drawn and the
+   level, so a board from a worker is the same one boardReset() would have
+   drawn itself, and replays are unaffected by which thread made it */
+
+struct PreparedBoard {
+  Bitboard isPresent, isMoving;
+  int optimalMoves;
+  float difficulty;
+  bool repaired;
+};
+
+const int boardAttempts = 8; // draws before an unsolvable board is repaired
+const int levelsAhead = 4;   // winning levels prepared past the current one
+
+/* A cell is a hole with odds 1 in holes/level, and moves with odds 1 in
+   moving/level. The game always plays the defaults, other values are for
+   tuning them with --evaluate */
+struct BoardDensity {
+  int holes = 30;
+  int moving = 40;
+};
+
+const BoardDensity defaultDensity = BoardDensity();
+
+/* Densities bottom out at level 'holes', past it every draw would be a
+   hole. The diagonals are always present, and only present cells off them
+   move */
+void generateBoard(Rng &rng, int level, const BoardDensity &density, Bitboard &isPresent, Bitboard &isMoving) {
+  isPresent = isMoving = emptyBoard;
+  for(int i=0; i<10; i++) for(int j=0;j<10;j++) {
+    int temp = rngBelow(rng, max(density.holes/level, 1));
+    isPresent.assign(i, j, temp != 0);
+  }
+  for(int i=0; i<10; i++) for(int j=0;j<10;j++) {
+    int temp = rngBelow(rng, max(density.moving/level, 1));
+    isMoving.assign(i, j, temp == 0);
+  }
+  isPresent |= diagonals;
+  isMoving = andNot(isMoving & isPresent, diagonals);
+}
+
+/* Longer paths, more holes and more moving blocks make a harder board */
+float boardDifficulty(const PreparedBoard &b) {
+  int holes = (~b.isPresent).count(), moving = b.isMoving.count();
+  return b.optimalMoves + 0.25f * holes + 0.5f * moving;
+}
+
+/* Draw board 'number' of the game seeded with 'seed', at 'level' */
+void prepareBoard(unsigned seed, long number, int level, PreparedBoard &b, const BoardDensity &density = defaultDensity) {
+  Rng rng;
+  rngSeed(rng, seed ^ ((uint64_t)number * 0x9e3779b97f4a7c15ULL), 16 + level);
+  int attempt = 0;
+  do generateBoard(rng, level, density, b.isPresent, b.isMoving);
+  while((b.optimalMoves = solveBoard(b.isPresent, b.isMoving)) < 0 && ++attempt < boardAttempts);
+
+  b.repaired = b.optimalMoves < 0;
+  if(b.repaired) {
+    repairBoard(b.isPresent, b.isMoving);
+    b.optimalMoves = solveBoard(b.isPresent, b.isMoving);
+  }
+  b.difficulty = boardDifficulty(b);
+}
+
+struct BoardKey {
+  unsigned seed;
+  long number;
+  int level;
+  bool operator<(const BoardKey &o) const {
+    if(seed != o.seed) return seed < o.seed;
+    if(number != o.number) return number < o.number;
+    return level < o.level;
+  }
+};
+
+ThreadPool levelPool;
+bool levelPipelineRunning = false;
+std::mutex preparedMutex;
+std::map<BoardKey, PreparedBoard> preparedBoards; // finished by a worker
+std::set<BoardKey> pendingBoards;                  // queued or in progress
+
+void startLevelPipeline(int threads) {
+  startPool(levelPool, threads);
+  levelPipelineRunning = true;
+}
+
+void stopLevelPipeline() {
+  if(!levelPipelineRunning) return;
+  levelPipelineRunning = false;
+  stopPool(levelPool);
+}
+
+void queueBoard(const BoardKey &key) {
+  {
+    std::lock_guard<std::mutex> lock(preparedMutex);
+    if(preparedBoards.count(key) || pendingBoards.count(key)) return;
+    pendingBoards.insert(key);
+  }
+  submit(levelPool, [key] {
+    PreparedBoard b;
+    prepareBoard(key.seed, key.number, key.level, b);
+    std::lock_guard<std::mutex> lock(preparedMutex);
+    pendingBoards.erase(key);
+    preparedBoards[key] = b;
+  });
+}
+
+/* After board 'number' at 'level' the next one is either the following
+   level, or level 1 after a loss. Both are queued, the winning streak
+   levelsAhead deep */
+void prefetchBoards(unsigned seed, long number, int level) {
+  if(!levelPipelineRunning) return;
+  queueBoard(BoardKey{ seed, number + 1, 1 });
+  for(int k = 1; k <= levelsAhead; k++) queueBoard(BoardKey{ seed, number + k, level + k });
+}
+
+/* Prepared board for the key if a worker finished it, boards the game has
+   gone past are dropped */
+bool takePreparedBoard(unsigned seed, long number, int level, PreparedBoard &b) {
+  if(!levelPipelineRunning) return false;
+  std::lock_guard<std::mutex> lock(preparedMutex);
+  BoardKey key = { seed, number, level };
+  std::map<BoardKey, PreparedBoard>::iterator it = preparedBoards.find(key);
+  bool found = it != preparedBoards.end();
+  if(found) b = it->second;
+  it = preparedBoards.lower_bound(BoardKey{ seed, 0, 0 });
+  while(it != preparedBoards.end() && it->first.seed == seed && it->first.number <= number) preparedBoards.erase(it++);
+  return found;
+}
+
+#endif
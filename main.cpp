@@ -1,4 +1,13 @@
 #include "custom.h"
+#include "animation.h"
+#include "textures.h"
+#include "sprites.h"
+#include "shaders.h"
+#include "simulation.h"
+#include "evaluate.h"
+#include "server.h"
+#include "net.h"
+#include "broadphase.h"
 #include <AL/al.h>
 #include <AL/alc.h>
 
@@ -55,84 +64,6 @@ static inline ALenum to_al_format(short channels, short samples)
   }
 }
 
-
-/* Function to load Shaders - Use it as it is */
-GLuint LoadShaders(const char * vertex_file_path,const char * fragment_file_path) {
-
-  // Create the shaders
-  GLuint VertexShaderID = glCreateShader(GL_VERTEX_SHADER);
-  GLuint FragmentShaderID = glCreateShader(GL_FRAGMENT_SHADER);
-
-  // Read the Vertex Shader code from the file
-  std::string VertexShaderCode;
-  std::ifstream VertexShaderStream(vertex_file_path, std::ios::in);
-  if(VertexShaderStream.is_open())
-  {
-    std::string Line = "";
-    while(getline(VertexShaderStream, Line))
-      VertexShaderCode += "\n" + Line;
-    VertexShaderStream.close();
-  }
-
-  // Read the Fragment Shader code from the file
-  std::string FragmentShaderCode;
-  std::ifstream FragmentShaderStream(fragment_file_path, std::ios::in);
-  if(FragmentShaderStream.is_open()){
-    std::string Line = "";
-    while(getline(FragmentShaderStream, Line))
-      FragmentShaderCode += "\n" + Line;
-    FragmentShaderStream.close();
-  }
-
-  GLint Result = GL_FALSE;
-  int InfoLogLength;
-
-  // Compile Vertex Shader
-  cout << "Compiling shader : " <<  vertex_file_path << endl;
-  char const * VertexSourcePointer = VertexShaderCode.c_str();
-  glShaderSource(VertexShaderID, 1, &VertexSourcePointer , NULL);
-  glCompileShader(VertexShaderID);
-
-  // Check Vertex Shader
-  glGetShaderiv(VertexShaderID, GL_COMPILE_STATUS, &Result);
-  glGetShaderiv(VertexShaderID, GL_INFO_LOG_LENGTH, &InfoLogLength);
-  std::vector<char> VertexShaderErrorMessage( max(InfoLogLength, int(1)) );
-  glGetShaderInfoLog(VertexShaderID, InfoLogLength, NULL, &VertexShaderErrorMessage[0]);
-  cout << VertexShaderErrorMessage.data() << endl;
-
-  // Compile Fragment Shader
-  cout << "Compiling shader : " << fragment_file_path << endl;
-  char const * FragmentSourcePointer = FragmentShaderCode.c_str();
-  glShaderSource(FragmentShaderID, 1, &FragmentSourcePointer , NULL);
-  glCompileShader(FragmentShaderID);
-
-  // Check Fragment Shader
-  glGetShaderiv(FragmentShaderID, GL_COMPILE_STATUS, &Result);
-  glGetShaderiv(FragmentShaderID, GL_INFO_LOG_LENGTH, &InfoLogLength);
-  std::vector<char> FragmentShaderErrorMessage( max(InfoLogLength, int(1)) );
-  glGetShaderInfoLog(FragmentShaderID, InfoLogLength, NULL, &FragmentShaderErrorMessage[0]);
-  cout << FragmentShaderErrorMessage.data() << endl;
-
-  // Link the program
-  cout << "Linking program" << endl;
-  GLuint ProgramID = glCreateProgram();
-  glAttachShader(ProgramID, VertexShaderID);
-  glAttachShader(ProgramID, FragmentShaderID);
-  glLinkProgram(ProgramID);
-
-  // Check the program
-  glGetProgramiv(ProgramID, GL_LINK_STATUS, &Result);
-  glGetProgramiv(ProgramID, GL_INFO_LOG_LENGTH, &InfoLogLength);
-  std::vector<char> ProgramErrorMessage( max(InfoLogLength, int(1)) );
-  glGetProgramInfoLog(ProgramID, InfoLogLength, NULL, &ProgramErrorMessage[0]);
-  cout << ProgramErrorMessage.data() << endl;
-
-  glDeleteShader(VertexShaderID);
-  glDeleteShader(FragmentShaderID);
-
-  return ProgramID;
-}
-
 static void error_callback(int error, const char* description)
 {
   cout << "Error: " << description << endl;
@@ -140,6 +71,8 @@ static void error_callback(int error, const char* description)
 
 void quit(GLFWwindow *window)
 {
+  stopSimulation();
+  stopLevelPipeline();
   glfwDestroyWindow(window);
   glfwTerminate();
   exit(EXIT_SUCCESS);
@@ -312,7 +245,8 @@ void draw3DTexturedObject (struct VAO* vao)
 
 
 /* Create an OpenGL Texture from an image */
-GLuint createTexture (const char* filename)
+/* 'set' groups textures in the memory report */
+GLuint createTexture (const char* filename, const char* set)
 {
   GLuint TextureID;
   // Generate Texture Buffer
@@ -330,10 +264,31 @@ GLuint createTexture (const char* filename)
   // Load image and create OpenGL texture
   int twidth, theight;
   unsigned char* image = SOIL_load_image(filename, &twidth, &theight, 0, SOIL_LOAD_RGB);
-  glTexImage2D(GL_TEXTURE_2D, 0, GL_RGB, twidth, theight, 0, GL_RGB, GL_UNSIGNED_BYTE, image);
+  if(image == NULL) {
+    cout << "SOIL loading error: '" << filename << "' " << SOIL_last_result() << endl;
+    glBindTexture(GL_TEXTURE_2D, 0);
+    return TextureID;
+  }
+
+  // Downscale when the texture budget would be exceeded
+  GLenum internalFormat = textureInternalFormat();
+  int downscale = textureDownscale(internalFormat, twidth, theight, 1);
+  int w = twidth / downscale, h = theight / downscale;
+  vector<unsigned char> scaled;
+  const unsigned char* pixels = image;
+  if(downscale > 1) {
+    scaled.resize(3 * w * h);
+    resampleImage(image, twidth, theight, &scaled[0], w, h);
+    pixels = &scaled[0];
+  }
+
+  glPixelStorei(GL_UNPACK_ALIGNMENT, 1); // RGB rows are not always 4 byte aligned
+  glTexImage2D(GL_TEXTURE_2D, 0, internalFormat, w, h, 0, GL_RGB, GL_UNSIGNED_BYTE, pixels);
+  glPixelStorei(GL_UNPACK_ALIGNMENT, 4);
   glGenerateMipmap(GL_TEXTURE_2D); // Generate MipMaps to use
   SOIL_free_image_data(image); // Free the data read from file after creating opengl texture
   glBindTexture(GL_TEXTURE_2D, 0); // Unbind texture when done, so we won't accidentily mess it up
+  trackTexture(TextureID, set, w, h, 1, downscale, internalFormat);
 
   return TextureID;
 }
@@ -344,75 +299,33 @@ void scrollCallback(GLFWwindow* window, double x, double y) {
 }
 
 
+/* Game keys become input events for the simulation thread, see input.h */
+int inputKey(int key)
+{
+  switch (key) {
+    case GLFW_KEY_UP: return INPUT_UP;
+    case GLFW_KEY_DOWN: return INPUT_DOWN;
+    case GLFW_KEY_RIGHT: return INPUT_RIGHT;
+    case GLFW_KEY_LEFT: return INPUT_LEFT;
+    case GLFW_KEY_SPACE: return INPUT_JUMP;
+    case GLFW_KEY_F: return INPUT_FASTER;
+    case GLFW_KEY_S: return INPUT_SLOWER;
+    default:
+      if(key >= GLFW_KEY_1 && key <= GLFW_KEY_9) return INPUT_HOUSE1 + key - GLFW_KEY_1;
+      return -1;
+  }
+}
+
 void keyboard (GLFWwindow* window, int key, int scancode, int action, int mods)
 {
   // Function is called first on GLFW_PRESS.
 
   if (action == GLFW_RELEASE) {
-    if(onMenu == true) {
-    if(key == GLFW_KEY_1) playerHouse = 1, onMenu = false;
-    if(key == GLFW_KEY_2) playerHouse = 2, onMenu = false;
-    if(key == GLFW_KEY_3) playerHouse = 3, onMenu = false;
-    if(key == GLFW_KEY_4) playerHouse = 4, onMenu = false;
-    if(key == GLFW_KEY_5) playerHouse = 5, onMenu = false;
-    if(key == GLFW_KEY_6) playerHouse = 6, onMenu = false;
-    if(key == GLFW_KEY_7) playerHouse = 7, onMenu = false;
-    if(key == GLFW_KEY_8) playerHouse = 8, onMenu = false;
-    if(key == GLFW_KEY_9) playerHouse = 9, onMenu = false;
-    if(onMenu == false) boardReset();
-    
-    gameStart = glfwGetTime();
-    
-  }
-
     if(key == GLFW_KEY_R) {
       viewPtr[currentView] = (viewPtr[currentView]+1) % numSubViews[currentView]; 
     }
     if(key == GLFW_KEY_L) lightOn = !lightOn;
-    if(key == GLFW_KEY_UP) {
-      if(currentView == 2 or currentView == 3) {
-
-        if(playerDirection == 1) playerMoveUp = false;
-        else if(playerDirection == 2) playerMoveDown = false;
-        else if(playerDirection == 3) playerMoveRight = false;
-        else if(playerDirection == 4) playerMoveLeft = false;
-      }
-      else playerMoveUp = false;
-
-    }
-    else if(key == GLFW_KEY_DOWN) {
-      if(currentView == 2 or currentView == 3) {
-
-        if(playerDirection == 1) playerMoveUp = false;
-        else if(playerDirection == 2) playerMoveDown = false;
-        else if(playerDirection == 3) playerMoveRight = false;
-        else if(playerDirection == 4) playerMoveLeft = false;
-      }
-      else playerMoveDown = false;
-    }
-    else if(key == GLFW_KEY_RIGHT) {
-      if(currentView == 2 or currentView == 3) {
-
-        if(playerDirection == 1) playerMoveUp = false;
-        else if(playerDirection == 2) playerMoveDown = false;
-        else if(playerDirection == 3) playerMoveRight = false;
-        else if(playerDirection == 4) playerMoveLeft = false;
-      }
-      else playerMoveRight = false;
-    }
-    else if(key == GLFW_KEY_LEFT) {
-      if(currentView == 2 or currentView == 3) {
-
-        if(playerDirection == 1) playerMoveUp = false;
-        else if(playerDirection == 2) playerMoveDown = false;
-        else if(playerDirection == 3) playerMoveRight = false;
-        else if(playerDirection == 4) playerMoveLeft = false;
-      }
-      else playerMoveLeft = false;
-    }
-    else if(key == GLFW_KEY_F && speed<7) speed += 1;
-    else if(key == GLFW_KEY_S && speed>0) speed -= 1;
-
+    if(key == GLFW_KEY_P) simPaused = !simPaused;
   }
   else if (action == GLFW_PRESS) {
     switch (key) {
@@ -425,98 +338,11 @@ void keyboard (GLFWwindow* window, int key, int scancode, int action, int mods)
     if(key == GLFW_KEY_V) {
       currentView = (currentView + 1) % numViews;
     }
-    if(playerFall or playerJumpUp or playerJumpDown or playerJumpRight or playerJumpLeft or playerWin) return;
-    if(key == GLFW_KEY_UP && glfwGetKey(window, GLFW_KEY_SPACE) && !playerFall && !playerJumpUp && !playerJumpDown && !playerJumpRight && !playerJumpLeft) {
-      prevPlayerX = playerX;
-      prevPlayerZ = playerZ;
-      if(currentView == 2 or currentView == 3) {
-        if(playerDirection == 1) playerJumpUp = true;
-        else if(playerDirection == 3) playerJumpRight = true;
-        else if(playerDirection == 2) playerJumpDown = true;
-        else if(playerDirection == 4) playerJumpLeft = true;
-      }
-      else playerJumpUp = true, playerDirection = 1;
-    }
-    else if(key == GLFW_KEY_DOWN && glfwGetKey(window, GLFW_KEY_SPACE) && !playerFall && !playerJumpUp && !playerJumpDown && !playerJumpRight && !playerJumpLeft) {
-      prevPlayerX = playerX;
-      prevPlayerZ = playerZ;     
-      if(currentView == 2 or currentView == 3) {
-
-        if(playerDirection == 1) playerJumpDown = true, playerDirection = 2;
-        else if(playerDirection == 3) playerJumpLeft = true, playerDirection = 4;
-        else if(playerDirection == 4) playerJumpRight = true, playerDirection = 3;
-        else if(playerDirection == 2) playerJumpUp = true, playerDirection = 1;
-      }
-      else playerJumpDown = true, playerDirection = 2;
-    }
-    else if(key == GLFW_KEY_RIGHT && glfwGetKey(window, GLFW_KEY_SPACE) && !playerFall && !playerJumpUp && !playerJumpDown && !playerJumpRight && !playerJumpLeft) {
-      prevPlayerX = playerX;
-      prevPlayerZ = playerZ; 
-      if(currentView == 2 or currentView == 3) {
-
-        if(playerDirection == 3) playerJumpDown = true, playerDirection = 2;
-        else if(playerDirection == 1) playerJumpRight = true, playerDirection = 3;
-        else if(playerDirection == 4) playerJumpUp = true, playerDirection = 1;
-        else if(playerDirection == 2) playerJumpLeft = true, playerDirection = 4;    
-      }
-      else playerJumpRight = true, playerDirection = 3;
-
-    }
-    else if(key == GLFW_KEY_LEFT && glfwGetKey(window, GLFW_KEY_SPACE) && !playerFall && !playerJumpUp && !playerJumpDown && !playerJumpRight && !playerJumpLeft) {
-      prevPlayerX = playerX;
-      prevPlayerZ = playerZ; 
-      if(currentView == 2 or currentView == 3) {
-
-        if(playerDirection == 1) playerJumpLeft = true, playerDirection = 4;
-        else if(playerDirection == 2) playerJumpRight = true, playerDirection = 3;
-        else if(playerDirection == 3) playerJumpUp = true, playerDirection = 1;
-        else if(playerDirection == 4) playerJumpDown = true, playerDirection = 2;    
-      }
-      else playerJumpLeft = true, playerDirection = 4;
-    }
-    else if(key == GLFW_KEY_UP) {
-      if(currentView == 2 or currentView == 3) {
-        if(playerDirection == 1) playerMoveUp = true;
-        else if(playerDirection == 3) playerMoveRight = true;
-        else if(playerDirection == 2) playerMoveDown = true;
-        else if(playerDirection == 4) playerMoveLeft = true;
-      }
-      else playerMoveUp = true, playerDirection = 1;
-    }
-    else if(key == GLFW_KEY_DOWN) {
-      if(currentView == 2 or currentView == 3) {
-
-        if(playerDirection == 1) playerMoveDown = true, playerDirection = 2;
-        else if(playerDirection == 3) playerMoveLeft = true, playerDirection = 4;
-        else if(playerDirection == 4) playerMoveRight = true, playerDirection = 3;
-        else if(playerDirection == 2) playerMoveUp = true, playerDirection = 1;
-      }
-      else playerMoveDown = true, playerDirection = 2;
-
-    }
-    else if(key == GLFW_KEY_RIGHT) {
-      if(currentView == 2 or currentView == 3) {
-
-        if(playerDirection == 3) playerMoveDown = true, playerDirection = 2;
-        else if(playerDirection == 1) playerMoveRight = true, playerDirection = 3;
-        else if(playerDirection == 4) playerMoveUp = true, playerDirection = 1;
-        else if(playerDirection == 2) playerMoveLeft = true, playerDirection = 4;    
-      }
-      else playerMoveRight = true, playerDirection = 3;
-
-    }
-    else if(key == GLFW_KEY_LEFT) {
-      if(currentView == 2 or currentView == 3) {
-
-        if(playerDirection == 1) playerMoveLeft = true, playerDirection = 4;
-        else if(playerDirection == 2) playerMoveRight = true, playerDirection = 3;
-        else if(playerDirection == 3) playerMoveUp = true, playerDirection = 1;
-        else if(playerDirection == 4) playerMoveDown = true, playerDirection = 2;    
-      }
-      else playerMoveLeft = true, playerDirection = 4;
-
-    }   
   }
+  else return; // GLFW_REPEAT
+
+  int input = inputKey(key);
+  if(input >= 0) pushInput(input, action == GLFW_PRESS, currentView == 2 or currentView == 3);
 }
 
 /* Executed for character input (like in text boxes) */
@@ -567,12 +393,15 @@ void mouseButton (GLFWwindow* window, int button, int action, int mods)
 
 /* Executed when window is resized to 'width' and 'height' */
 /* Modify the bounds of the screen here in glm::ortho or Field of View in glm::Perspective */
+int framebufferWidth = 0, framebufferHeight = 0; // set by reshapeWindow()
+
 void reshapeWindow (GLFWwindow* window, int width, int height)
 {
   int fbwidth=width, fbheight=height;
   /* With Retina display on Mac OS X, GLFW's FramebufferSize
      is different from WindowSize */
   glfwGetFramebufferSize(window, &fbwidth, &fbheight);
+  framebufferWidth = fbwidth, framebufferHeight = fbheight;
 
   GLfloat fov = 45.0f;
 
@@ -591,6 +420,14 @@ void reshapeWindow (GLFWwindow* window, int width, int height)
   //Matrices.projection = glm::ortho(-10.0f, 10.0f, -10.0f, 10.0f, 0.1f, 500.0f);
 }
 
+bool screenDamaged = true; // the window shows nothing valid, set by refreshWindow()
+
+/* The window was uncovered or needs its contents again */
+void refreshWindow (GLFWwindow* window)
+{
+  screenDamaged = true;
+}
+
 
 GLFWwindow* initGLFW (int width, int height)
 {
@@ -624,6 +461,7 @@ GLFWwindow* initGLFW (int width, int height)
      is different from WindowSize */
   glfwSetFramebufferSizeCallback(window, reshapeWindow);
   glfwSetWindowSizeCallback(window, reshapeWindow);
+  glfwSetWindowRefreshCallback(window, refreshWindow);
 
   /* Register function to handle window close */
   glfwSetWindowCloseCallback(window, quit);
@@ -977,15 +815,6 @@ void createShapes() {
 void createRectangle ()
 {
   // GL3 accepts only Triangles. Quads are not supported
-  static const GLfloat vertex_buffer_data [] = {
-    -0.5,-0.5,0, // vertex 1
-    0.5,-0.5,0, // vertex 2
-    0.5, 0.5,0, // vertex 3
-
-    0.5, 0.5,0, // vertex 3
-    -0.5, 0.5,0, // vertex 4
-    -0.5,-0.5,0  // vertex 1
-  };
   static const GLfloat vertex_buffer_data2 [] = {
     -0.35,-0.35,0, // vertex 1
     0.35,-0.35,0, // vertex 2
@@ -996,16 +825,6 @@ void createRectangle ()
     -0.35,-0.35,0  // vertex 1
   };
 
-  static const GLfloat vertex_buffer_data3 [] = {
-    -18,-18,0, // vertex 1
-    18,-18,0, // vertex 2
-    18, 18,0, // vertex 3
-
-    18, 18,0, // vertex 3
-    -18, 18,0, // vertex 4
-    -18,-18,0  // vertex 1
-  };
-
 
   static const GLfloat vertex_buffer_data4 [] = {
     -1,-1,0, // vertex 1
@@ -1027,20 +846,6 @@ void createRectangle ()
     w/2, h/2,0, // vertex 3
     -w/2, h/2,0 // vertex 4
   };
-  w = 8, h = 8;
-
-  GLfloat vertex_buffer_data5 [] = {
-    -w/2,-h/2,0, // vertex 1
-    w/2,-h/2,0, // vertex 2
-    w/2, h/2,0, // vertex 3
-
-
-
-    w/2, h/2,0, // vertex 3
-    -w/2, h/2,0, // vertex 4
-    -w/2,-h/2,0 // vertex 1
-  };
-
   w = 14, h = 4;
 
   GLfloat vertex_buffer_data6 [] = {
@@ -1107,21 +912,7 @@ void createRectangle ()
   speedy[0] = create3DObject(GL_TRIANGLES, 6, vertex_buffer_data_speedy, color_buffer_data_speedy, GL_FILL);
   speedy[1] = create3DObject(GL_TRIANGLES, 6, vertex_buffer_data_speedy, color_buffer_data_speedy_null, GL_FILL);
   // create3DObject creates and returns a handle to a VAO that can be used later
-  for(int i = 0; i<16; i++)
-    timer[i] = create3DTexturedObject(GL_TRIANGLES, 6, vertex_buffer_data, texture_buffer_data, textureID[i], GL_FILL);
-
-
-  for(int i = 0; i<3; i++) 
-    stars[i] = create3DTexturedObject(GL_TRIANGLES, 6, vertex_buffer_data2, texture_buffer_data, textureID[16+i], GL_FILL);
-  for(int i=0; i<22; i++) 
-    hearts[i] = create3DTexturedObject(GL_TRIANGLES, 6, vertex_buffer_data, texture_buffer_data, textureID[19+i], GL_FILL);
-  for(int i = 0; i<25; i++) {
-    water[i] = create3DTexturedObject(GL_TRIANGLES, 6, vertex_buffer_data3, texture_buffer_data, textureID[41+i], GL_FILL);
-  }
-  for(int i=0; i<120; i++)
-    soldier[i] = create3DTexturedObject(GL_TRIANGLES, 6, vertex_buffer_data5, texture_buffer_data, textureID[72+i], GL_FILL);
-  for(int i = 0; i<12; i++) 
-    dragon[i] = create3DTexturedObject(GL_TRIANGLES, 6, vertex_buffer_data5, texture_buffer_data, textureID[192+i], GL_FILL);
+  // Animated sprites (timer, stars, lives, water, soldier, dragon) are batched in sprites.h
 
   square[0] = create3DTexturedObject(GL_TRIANGLES, 6, vertex_buffer_data4, texture_buffer_data, textureID[66], GL_FILL);
   square[1] = create3DTexturedObject(GL_TRIANGLES, 6, vertex_buffer_data4, texture_buffer_data, textureID[67], GL_FILL);
@@ -1244,6 +1035,27 @@ void createSphere(int slices, int stacks) {
 
 
 
+}
+
+/* Handles of every uniform we set, fetched again after a shader hot reload */
+void getUniformLocations()
+{
+  // Get a handle for our "MVP" uniform
+  Matrices.MatrixID = glGetUniformLocation(programID, "MVP");
+  Matrices.TexMatrixID = glGetUniformLocation(textureProgramID, "MVP");
+
+  // Animated sprites pick their frame from the "time" uniform
+  SpriteProgram.MatrixID = glGetUniformLocation(SpriteProgram.programID, "MVP");
+  SpriteProgram.TimeID = glGetUniformLocation(SpriteProgram.programID, "time");
+  SpriteProgram.SamplerID = glGetUniformLocation(SpriteProgram.programID, "spriteSampler");
+
+  GLint fontVertexCoordAttrib, fontVertexNormalAttrib, fontVertexOffsetUniform;
+  fontVertexCoordAttrib = glGetAttribLocation(fontProgramID, "vertexPosition");
+  fontVertexNormalAttrib = glGetAttribLocation(fontProgramID, "vertexNormal");
+  fontVertexOffsetUniform = glGetUniformLocation(fontProgramID, "pen");
+  GL3Font.fontMatrixID = glGetUniformLocation(fontProgramID, "MVP");
+  GL3Font.fontColorID = glGetUniformLocation(fontProgramID, "fontColor");
+  GL3Font.font->ShaderLocations(fontVertexCoordAttrib, fontVertexNormalAttrib, fontVertexOffsetUniform);
 }
 
 void initGL (GLFWwindow* window, int width, int height)
@@ -1254,100 +1066,25 @@ void initGL (GLFWwindow* window, int width, int height)
   // load an image file directly as a new OpenGL texture
   // GLuint texID = SOIL_load_OGL_texture ("beach.png", SOIL_LOAD_AUTO, SOIL_CREATE_NEW_ID, SOIL_FLAG_TEXTURE_REPEATS); // Buggy for OpenGL
 
-  textureID[0] = createTexture("images/timer/frame_0_delay-0.jpg");
-  textureID[1] = createTexture("images/timer/frame_1_delay-0.jpg");
-  textureID[2] = createTexture("images/timer/frame_2_delay-0.jpg");
-  textureID[3] = createTexture("images/timer/frame_3_delay-0.jpg");
-  textureID[4] = createTexture("images/timer/frame_4_delay-0.jpg");
-  textureID[5] = createTexture("images/timer/frame_5_delay-0.jpg");
-  textureID[6] = createTexture("images/timer/frame_6_delay-0.jpg");
-  textureID[7] = createTexture("images/timer/frame_7_delay-0.jpg");
-  textureID[8] = createTexture("images/timer/frame_8_delay-0.jpg");
-  textureID[9] = createTexture("images/timer/frame_9_delay-0.jpg");
-  textureID[10] = createTexture("images/timer/frame_10_delay-0.jpg");
-  textureID[11] = createTexture("images/timer/frame_11_delay-0.jpg");
-  textureID[12] = createTexture("images/timer/frame_12_delay-0.jpg");
-  textureID[13] = createTexture("images/timer/frame_13_delay-0.jpg");
-  textureID[14] = createTexture("images/timer/frame_14_delay-0.jpg");
-  textureID[15] = createTexture("images/timer/frame_15_delay-0.jpg");
-
-  textureID[16] = createTexture("images/stars/frame_0_delay-0.jpg");
-  textureID[17] = createTexture("images/stars/frame_1_delay-0.jpg");
-  textureID[18] = createTexture("images/stars/frame_2_delay-0.jpg");
-
-  textureID[19] = createTexture("images/lives/frame-001.jpg");
-  textureID[20] = createTexture("images/lives/frame-002.jpg");
-  textureID[21] = createTexture("images/lives/frame-003.jpg");
-  textureID[22] = createTexture("images/lives/frame-004.jpg");
-  textureID[23] = createTexture("images/lives/frame-005.jpg");
-  textureID[24] = createTexture("images/lives/frame-006.jpg");
-  textureID[25] = createTexture("images/lives/frame-007.jpg");
-  textureID[26] = createTexture("images/lives/frame-008.jpg");
-  textureID[27] = createTexture("images/lives/frame-009.jpg");
-  textureID[28] = createTexture("images/lives/frame-010.jpg");
-  textureID[29] = createTexture("images/lives/frame-011.jpg");
-  textureID[30] = createTexture("images/lives/frame-012.jpg");
-  textureID[31] = createTexture("images/lives/frame-013.jpg");
-  textureID[32] = createTexture("images/lives/frame-014.jpg");
-  textureID[33] = createTexture("images/lives/frame-015.jpg");
-  textureID[34] = createTexture("images/lives/frame-016.jpg");
-  textureID[35] = createTexture("images/lives/frame-017.jpg");
-  textureID[36] = createTexture("images/lives/frame-018.jpg");
-  textureID[37] = createTexture("images/lives/frame-019.jpg");
-  textureID[38] = createTexture("images/lives/frame-020.jpg");
-  textureID[39] = createTexture("images/lives/frame-021.jpg");
-  textureID[40] = createTexture("images/lives/frame-022.jpg");
-
-  textureID[41] = createTexture("images/water/frame-001.jpg");
-  textureID[42] = createTexture("images/water/frame-002.jpg");
-  textureID[43] = createTexture("images/water/frame-003.jpg");
-  textureID[44] = createTexture("images/water/frame-004.jpg");
-  textureID[45] = createTexture("images/water/frame-005.jpg");
-  textureID[46] = createTexture("images/water/frame-006.jpg");
-  textureID[47] = createTexture("images/water/frame-007.jpg");
-  textureID[48] = createTexture("images/water/frame-008.jpg");
-  textureID[49] = createTexture("images/water/frame-009.jpg");
-  textureID[50] = createTexture("images/water/frame-010.jpg");
-  textureID[51] = createTexture("images/water/frame-011.jpg");
-  textureID[52] = createTexture("images/water/frame-012.jpg");
-  textureID[53] = createTexture("images/water/frame-013.jpg");
-  textureID[54] = createTexture("images/water/frame-014.jpg");
-  textureID[55] = createTexture("images/water/frame-015.jpg");
-  textureID[56] = createTexture("images/water/frame-016.jpg");
-  textureID[57] = createTexture("images/water/frame-017.jpg");
-  textureID[58] = createTexture("images/water/frame-018.jpg");
-  textureID[59] = createTexture("images/water/frame-019.jpg");
-  textureID[60] = createTexture("images/water/frame-020.jpg");
-  textureID[61] = createTexture("images/water/frame-021.jpg");
-  textureID[62] = createTexture("images/water/frame-022.jpg");
-  textureID[63] = createTexture("images/water/frame-023.jpg");
-  textureID[64] = createTexture("images/water/frame-024.jpg");
-  textureID[65] = createTexture("images/water/frame-025.jpg");
-
-  textureID[66] = createTexture("images/square.jpg");
-  textureID[67] = createTexture("images/square1.jpg");
-
-  textureID[68] = createTexture("images/tree.png");
-  textureID[69] = createTexture("images/star.jpg");
-  textureID[70] = createTexture("images/heart.png");
-  textureID[71] = createTexture("images/throne.jpg");
+  // Animation frames go into array textures, one layer per frame
+  createSpriteArrays();
+
+  textureID[66] = createTexture("images/square.jpg", "board");
+  textureID[67] = createTexture("images/square1.jpg", "board");
+
+  textureID[68] = createTexture("images/tree.png", "scenery");
+  textureID[69] = createTexture("images/star.jpg", "scenery");
+  textureID[70] = createTexture("images/heart.png", "scenery");
+  textureID[71] = createTexture("images/throne.jpg", "scenery");
   char ibuf[100];
-  for(int i = 0; i<120; i++) {
-    snprintf(ibuf, sizeof(ibuf), "images/soldier/o_a71eebd8de89d627-%d.jpg", i);
-    textureID[72+i] = createTexture(ibuf);
-  }
-  for(int i = 0; i<12; i++) {
-    snprintf(ibuf, sizeof(ibuf), "images/dragon/o_b90b52b369699b6e-%d.jpg", i);
-    textureID[192+i] = createTexture(ibuf);
-  }
 
-  textureID[204] = createTexture("images/grass.jpg");
-  textureID[205] = createTexture("images/wood.jpg");
-  textureID[206] = createTexture("images/menu.jpg");
-  textureID[207] = createTexture("images/banner.jpg");
+  textureID[204] = createTexture("images/grass.jpg", "board");
+  textureID[205] = createTexture("images/wood.jpg", "board");
+  textureID[206] = createTexture("images/menu.jpg", "menu");
+  textureID[207] = createTexture("images/banner.jpg", "menu");
     for(int i = 1; i<=9; i++) {
     snprintf(ibuf, sizeof(ibuf), "images/%d.jpg", i);
-    textureID[207+i] = createTexture(ibuf);
+    textureID[207+i] = createTexture(ibuf, "sigils");
   }
 
 
@@ -1362,15 +1099,26 @@ void initGL (GLFWwindow* window, int width, int height)
 
 
 
-  // check for an error during the load process
-  if(textureID == 0 )
-    cout << "SOIL loading error: '" << SOIL_last_result() << "'" << endl;
-
-  // Create and compile our GLSL program from the texture shaders
-  textureProgramID = LoadShaders( "TextureRender.vert", "TextureRender.frag" );
-  // Get a handle for our "MVP" uniform
-  Matrices.TexMatrixID = glGetUniformLocation(textureProgramID, "MVP");
+  printTextureReport();
 
+  // Create and compile all GLSL programs in one go, cached binaries are used when valid
+  ShaderJob jobs[] = {
+    shaderJob( "TextureRender.vert", "TextureRender.frag" ),
+    shaderJob( "AnimatedSprite.vert", "AnimatedSprite.frag" ),
+    shaderJob( "Sample_GL3.vert", "Sample_GL3.frag" ),
+    shaderJob( "fontrender.vert", "fontrender.frag" )
+  };
+  loadPrograms(jobs, 4);
+  textureProgramID = jobs[0].program;
+  SpriteProgram.programID = jobs[1].program;
+  programID = jobs[2].program;
+  fontProgramID = jobs[3].program;
+
+  // Rebuild programs when their sources are edited
+  watchProgram( "TextureRender.vert", "TextureRender.frag", &textureProgramID );
+  watchProgram( "AnimatedSprite.vert", "AnimatedSprite.frag", &SpriteProgram.programID );
+  watchProgram( "Sample_GL3.vert", "Sample_GL3.frag", &programID );
+  watchProgram( "fontrender.vert", "fontrender.frag", &fontProgramID );
 
   /* Objects should be created before any other gl function and shaders */
   // Create the modelsrray buffer
@@ -1378,11 +1126,14 @@ void initGL (GLFWwindow* window, int width, int height)
   createRectangle();
   createSphere(10, 10);
 
-  // Create and compile our GLSL program from the shaders
-  programID = LoadShaders( "Sample_GL3.vert", "Sample_GL3.frag" );
-  // Get a handle for our "MVP" uniform
-  Matrices.MatrixID = glGetUniformLocation(programID, "MVP");
-
+  // HUD sprites share one instanced draw, world sprites get one each
+  addSprite(CLIP_TIMER, glm::vec3(6.8,5,0), 1);
+  addSprite(CLIP_STARS, glm::vec3(3.4,5,0), 0.7);
+  addSprite(CLIP_LIVES, glm::vec3(-4.5,5,0), 1);
+  addSprite(CLIP_WATER, glm::vec3(0,0,0), 36);
+  addSprite(CLIP_SOLDIER, glm::vec3(0,0,0), 8);
+  addSprite(CLIP_DRAGON, glm::vec3(0,0,0), 8);
+  createSpriteBatches();
 
   reshapeWindow (window, width, height);
 
@@ -1406,16 +1157,7 @@ void initGL (GLFWwindow* window, int width, int height)
     exit(EXIT_FAILURE);
   }
 
-  // Create and compile our GLSL program from the font shaders
-  fontProgramID = LoadShaders( "fontrender.vert", "fontrender.frag" );
-  GLint fontVertexCoordAttrib, fontVertexNormalAttrib, fontVertexOffsetUniform;
-  fontVertexCoordAttrib = glGetAttribLocation(fontProgramID, "vertexPosition");
-  fontVertexNormalAttrib = glGetAttribLocation(fontProgramID, "vertexNormal");
-  fontVertexOffsetUniform = glGetUniformLocation(fontProgramID, "pen");
-  GL3Font.fontMatrixID = glGetUniformLocation(fontProgramID, "MVP");
-  GL3Font.fontColorID = glGetUniformLocation(fontProgramID, "fontColor");
-
-  GL3Font.font->ShaderLocations(fontVertexCoordAttrib, fontVertexNormalAttrib, fontVertexOffsetUniform);
+  getUniformLocations();
   GL3Font.font->FaceSize(1);
   GL3Font.font->Depth(0);
   GL3Font.font->Outset(0, 0);
@@ -1428,7 +1170,7 @@ void initGL (GLFWwindow* window, int width, int height)
 
 }
 
-void drawSpeedy() {
+void drawSpeedy(const Game &g) {
   float h = 0.25, w = 0.5, x = -10;
   glUseProgram (programID);
   float tempx=0;
@@ -1447,49 +1189,20 @@ void drawSpeedy() {
     MVP = VP * Matrices.model;
     glUniformMatrix4fv(Matrices.MatrixID, 1, GL_FALSE, &MVP[0][0]);
     // draw3DObject draws the VAO given to it using current MVP matrix
-    if (i<=speed)
+    if (i<=g.speed)
       draw3DObject(speedy[0]);
     else
       draw3DObject(speedy[1]);
   }
 }
 
-void drawTimer() {
-
-
-  static int i = 0, frames = 0;
-  if(frames == 3) frames = 0;
-  if(frames == 0) {
-    i++;
-    if(i==16) i = 0;
-
-  }
-
-  frames++;
-
-  glUseProgram (textureProgramID);
-  glm::mat4 translateRectangle;
+/* Timer, stars and g.lives in a single instanced draw */
+void drawHUD() {
   glm::mat4 VP = Matrices.projection * Matrices.view;
-  glm::mat4 MVP;  // MVP = Projection * View * Model
-  Matrices.model = glm::mat4(1.0f);
-  translateRectangle = glm::translate (glm::vec3(6.8,5,0));        // glTranslatef
-  Matrices.model *= (translateRectangle);
-  MVP = VP * Matrices.model;
-  glUniformMatrix4fv(Matrices.TexMatrixID, 1, GL_FALSE, &MVP[0][0]);
-  glUniform1i(glGetUniformLocation(textureProgramID, "texSampler"), 0);     
-  draw3DTexturedObject(timer[i]);
+  drawSpriteBatch(ARRAY_HUD, VP);
 }
 
 void drawBackground() {
-  static int i = 0, frames = 0;
-  if(frames == 15) frames = 0;
-  if(frames == 0) {
-    i++;
-    if(i==25) i = 0;
-  }
-
-  frames++;
-  glUseProgram (textureProgramID);
   glm::mat4 translateRectangle;
   glm::mat4 VP = Matrices.projection * Matrices.view;
   glm::mat4 MVP;  // MVP = Projection * View * Model
@@ -1499,48 +1212,20 @@ void drawBackground() {
   glm::mat4 rotateRectangle = glm::rotate((float)(-90*M_PI/180.0f), glm::vec3(1,0,0)); // glTranslatef
   Matrices.model *= (translateRectangle * rotateRectangle);
   MVP = VP * Matrices.model;
-  glUniformMatrix4fv(Matrices.TexMatrixID, 1, GL_FALSE, &MVP[0][0]);
-  glUniform1i(glGetUniformLocation(textureProgramID, "texSampler"), 0);     
-  draw3DTexturedObject(water[i]);
+  drawSpriteBatch(ARRAY_WATER, MVP);
 }
 
-void drawStars() {
-
-  static int i = 0, frames = 0;
-  if(frames == 5) frames = 0;
-  if(frames == 0) {
-    i++;
-    if(i==3) i = 0;
-   
-
-  }
-  frames++;
-  glUseProgram (textureProgramID);
-  glm::mat4 translateRectangle;
-  glm::mat4 VP = Matrices.projection * Matrices.view;
-  glm::mat4 MVP;  // MVP = Projection * View * Model
-  Matrices.model = glm::mat4(1.0f);
-  translateRectangle = glm::translate (glm::vec3(3.4,5,0));        // glTranslatef
-  Matrices.model *= (translateRectangle);
-  MVP = VP * Matrices.model;
-  glUniformMatrix4fv(Matrices.TexMatrixID, 1, GL_FALSE, &MVP[0][0]);
-  glUniform1i(glGetUniformLocation(textureProgramID, "texSampler"), 0);     
-  draw3DTexturedObject(stars[i]);
-
-
+/* Tower views that show the soldier and the dragon */
+bool soldierVisible() {
+  return currentView == 0 and (viewPtr[currentView] == 0 or viewPtr[currentView] == 1 or viewPtr[currentView] == 2);
 }
-void drawSoldier() {
-  if(currentView == 0 and (viewPtr[currentView] == 0 or viewPtr[currentView] == 1 or viewPtr[currentView] == 2)) {
 
+bool dragonVisible() {
+  return currentView == 0 and (viewPtr[currentView] == 0 or viewPtr[currentView] == 1 or viewPtr[currentView] == 7);
+}
 
-    static int i = 0, frames = 0;
-    if(frames == 2) frames = 0;
-    if(frames == 0) {
-      i++;
-      if(i==120) i = 0;
-    }
-    frames++;
-    glUseProgram (textureProgramID);
+void drawSoldier() {
+  if(soldierVisible()) {
     glm::mat4 translateRectangle, rotateRectangle;
     glm::mat4 VP = Matrices.projection * Matrices.view;
     glm::mat4 MVP;  // MVP = Projection * View * Model
@@ -1549,24 +1234,13 @@ void drawSoldier() {
     rotateRectangle = glm::rotate((float)(90*M_PI/180.0f), glm::vec3(0,1,0)); // glTranslatef
     Matrices.model *= (translateRectangle * rotateRectangle);    // glTranslatef
     MVP = VP * Matrices.model;
-    glUniformMatrix4fv(Matrices.TexMatrixID, 1, GL_FALSE, &MVP[0][0]);
-    glUniform1i(glGetUniformLocation(textureProgramID, "texSampler"), 0);     
-    draw3DTexturedObject(soldier[i]);
+    drawSpriteBatch(ARRAY_SOLDIER, MVP);
   }
 
 }
 
 void drawDragon() {
-  if(currentView == 0 and (viewPtr[currentView] == 0 or viewPtr[currentView] == 1 or viewPtr[currentView] == 7)) {
-
-    static int i = 0, frames = 0;
-    if(frames == 6) frames = 0;
-    if(frames == 0) {
-      i++;
-      if(i==12) i = 0;
-    }
-    frames++;
-    glUseProgram (textureProgramID);
+  if(dragonVisible()) {
     glm::mat4 translateRectangle, rotateRectangle;
     glm::mat4 VP = Matrices.projection * Matrices.view;
     glm::mat4 MVP;  // MVP = Projection * View * Model
@@ -1575,29 +1249,19 @@ void drawDragon() {
     rotateRectangle = glm::rotate((float)(90*M_PI/180.0f), glm::vec3(0,1,0)); // glTranslatef
     Matrices.model *= (translateRectangle * rotateRectangle);    // glTranslatef
     MVP = VP * Matrices.model;
-    glUniformMatrix4fv(Matrices.TexMatrixID, 1, GL_FALSE, &MVP[0][0]);
-    glUniform1i(glGetUniformLocation(textureProgramID, "texSampler"), 0);     
-    draw3DTexturedObject(dragon[i]);
+    drawSpriteBatch(ARRAY_DRAGON, MVP);
 
   }
 }
 
-void drawAnimate(VAO *object) {
-  animateX += 0.1;
-  if(animateX >= 10) {
-    if(starAnimate) starAnimate = false;
-    if(heartAnimate) heartAnimate = false;
-    animateX = -10, animateY = 3;
-    return;
-  }
-  if(animateX<0) animateY += 0.015;
-  else animateY -= 0.015;
+/* The flight path is advanced by updateAnimate() in game.h */
+void drawAnimate(const Game &g, VAO *object) {
   glUseProgram (textureProgramID);
   glm::mat4 translateRectangle;
   glm::mat4 VP = Matrices.projection * Matrices.view;
   glm::mat4 MVP;  // MVP = Projection * View * Model
   Matrices.model = glm::mat4(1.0f);
-  translateRectangle = glm::translate (glm::vec3(animateX,animateY,0));        // glTranslatef
+  translateRectangle = glm::translate (glm::vec3(g.animateX,g.animateY,0));        // glTranslatef
   Matrices.model *= (translateRectangle);
   MVP = VP * Matrices.model;
   glUniformMatrix4fv(Matrices.TexMatrixID, 1, GL_FALSE, &MVP[0][0]);
@@ -1608,31 +1272,6 @@ void drawAnimate(VAO *object) {
 }
 
 
-void drawLives() {
-
-  static int i = 0, frames = 0;
-  if(frames == 5) frames = 0;
-  if(frames == 0) {
-    i++;
-    if(i==22) i = 0;
-  }
-
-  frames++;
-
-  glUseProgram (textureProgramID);
-  glm::mat4 translateRectangle;
-  glm::mat4 VP = Matrices.projection * Matrices.view;
-  glm::mat4 MVP;  // MVP = Projection * View * Model
-  Matrices.model = glm::mat4(1.0f);
-  translateRectangle = glm::translate (glm::vec3(-4.5,5,0));        // glTranslatef
-  Matrices.model *= (translateRectangle);
-  MVP = VP * Matrices.model;
-  glUniformMatrix4fv(Matrices.TexMatrixID, 1, GL_FALSE, &MVP[0][0]);
-  glUniform1i(glGetUniformLocation(textureProgramID, "texSampler"), 0);     
-  draw3DTexturedObject(hearts[i]);
-}
-
-
 void drawMenu() {
   glUseProgram (textureProgramID);
   glm::mat4 translateRectangle;
@@ -1656,179 +1295,80 @@ void drawMenu() {
 
 }
 
-void writeTexts() {
-  glm::mat4 MVP;
-  static int fontScale = 0;
-  float fontScaleValue = 0.75 + 0.25*sinf(fontScale*M_PI/180.0f);
-
-  glm::vec3 fontColor = getRGBfromHue (fontScale);
-  glm::vec3 fontcolor2 = getRGBfromHue (1);
-
-
-  glm::mat4 translateText, scaleText;
-  // Use font Shaders for next part of code
-  glUseProgram(fontProgramID);
-if(onMenu == false) {
-  Matrices.model = glm::mat4(1.0f);
-  translateText = glm::translate(glm::vec3(4.4, 4.8,0));
-  scaleText = glm::scale(glm::vec3(fontScaleValue,fontScaleValue,fontScaleValue));
-  Matrices.model *= (translateText);
-  MVP = Matrices.projection * Matrices.view * Matrices.model;
+/* One line of text with its left end at (x, y) */
+void renderText(const char *text, float x, float y, const glm::vec3 &color) {
+  Matrices.model = glm::translate(glm::vec3(x, y, 0));
+  glm::mat4 MVP = Matrices.projection * Matrices.view * Matrices.model;
 
   // send font's MVP and font color to fond shaders
   glUniformMatrix4fv(GL3Font.fontMatrixID, 1, GL_FALSE, &MVP[0][0]);
-  glUniform3fv(GL3Font.fontColorID, 1, &fontColor[0]);
-  snprintf(buffer, sizeof(buffer), "%d", points);
-  GL3Font.font->Render(buffer);
-
-
-
-  Matrices.model = glm::mat4(1.0f);
-  translateText = glm::translate(glm::vec3(-2, 4,0));
-  scaleText = glm::scale(glm::vec3(fontScaleValue,fontScaleValue,fontScaleValue));
-  Matrices.model *= (translateText);
-  MVP = Matrices.projection * Matrices.view * Matrices.model;
-
-  // send font's MVP and font color to fond shaders
-  glUniformMatrix4fv(GL3Font.fontMatrixID, 1, GL_FALSE, &MVP[0][0]);
-  glUniform3fv(GL3Font.fontColorID, 1, &fontColor[0]);
-  snprintf(buffer, sizeof(buffer), "%s", "Congratulations!");
-  if(playerWin) GL3Font.font->Render(buffer);
-
-  
-
-
-  Matrices.model = glm::mat4(1.0f);
-  translateText = glm::translate(glm::vec3(-3.5,4.8,0));
-  scaleText = glm::scale(glm::vec3(fontScaleValue,fontScaleValue,fontScaleValue));
-  Matrices.model *= (translateText);
-  MVP = Matrices.projection * Matrices.view * Matrices.model;
-
-  // send font's MVP and font color to fond shaders
-  glUniformMatrix4fv(GL3Font.fontMatrixID, 1, GL_FALSE, &MVP[0][0]);
-  glUniform3fv(GL3Font.fontColorID, 1, &fontColor[0]);
-  snprintf(buffer, sizeof(buffer), "%d", lives);
-  GL3Font.font->Render(buffer);
-
-      Matrices.model = glm::mat4(1.0f);
-  translateText = glm::translate(glm::vec3(-1, 4,0));
-  scaleText = glm::scale(glm::vec3(fontScaleValue,fontScaleValue,fontScaleValue));
-  Matrices.model *= (translateText);
-  MVP = Matrices.projection * Matrices.view * Matrices.model;
-
-  // send font's MVP and font color to fond shaders
-  glUniformMatrix4fv(GL3Font.fontMatrixID, 1, GL_FALSE, &MVP[0][0]);
-  glUniform3fv(GL3Font.fontColorID, 1, &fontColor[0]);
-  snprintf(buffer, sizeof(buffer), "%s", "You lose!");
-  if(playerLose) 
-    GL3Font.font->Render(buffer);
-
-   Matrices.model = glm::mat4(1.0f);
-  translateText = glm::translate(glm::vec3(-1.2, 4.8,0));
-  scaleText = glm::scale(glm::vec3(fontScaleValue,fontScaleValue,fontScaleValue));
-  Matrices.model *= (translateText);
-  MVP = Matrices.projection * Matrices.view * Matrices.model;
+  glUniform3fv(GL3Font.fontColorID, 1, &color[0]);
+  GL3Font.font->Render(text);
+}
 
-  // send font's MVP and font color to fond shaders
-  glUniformMatrix4fv(GL3Font.fontMatrixID, 1, GL_FALSE, &MVP[0][0]);
-  glUniform3fv(GL3Font.fontColorID, 1, &fontColor[0]);
-  snprintf(buffer, sizeof(buffer), "%s%d", "Cleared: ", level);
-      GL3Font.font->Render(buffer);
+int fontScale = 0; // hue of the HUD texts, advanced every frame
 
-  Matrices.model = glm::mat4(1.0f);
-  translateText = glm::translate(glm::vec3(7.6,4.8,0));
-  scaleText = glm::scale(glm::vec3(fontScaleValue,fontScaleValue,fontScaleValue));
-  Matrices.model *= (translateText);
-  MVP = Matrices.projection * Matrices.view * Matrices.model;
+/* Points, lives, level and the clock of the board */
+void writeHUDTexts(const Game &g) {
+  glm::vec3 fontColor = getRGBfromHue (fontScale);
+  // Use font Shaders for next part of code
+  glUseProgram(fontProgramID);
+  snprintf(buffer, sizeof(buffer), "%d", g.points);
+  renderText(buffer, 4.4, 4.8, fontColor);
+  snprintf(buffer, sizeof(buffer), "%d", g.lives);
+  renderText(buffer, -3.5, 4.8, fontColor);
+  snprintf(buffer, sizeof(buffer), "%s%d", "Cleared: ", g.level);
+  renderText(buffer, -1.2, 4.8, fontColor);
 
-  // send font's MVP and font color to fond shaders
-  glUniformMatrix4fv(GL3Font.fontMatrixID, 1, GL_FALSE, &MVP[0][0]);
-  glUniform3fv(GL3Font.fontColorID, 1, &fontColor[0]);
   int hours, minutes, seconds;
-  if(!playerWin) currentTime = glfwGetTime() - gameStart;
-  hours = currentTime / 3600;
-  minutes = currentTime / 60;
-  seconds = currentTime % 60;
+  int elapsed = g.currentTime; // frozen by the simulation once the level is won
+  hours = elapsed / 3600;
+  minutes = elapsed / 60;
+  seconds = elapsed % 60;
   snprintf(buffer, sizeof(buffer), "%d:%d:%d", hours, minutes, seconds);
-  GL3Font.font->Render(buffer);
+  renderText(buffer, 7.6, 4.8, fontColor);
 }
-if(onMenu) {
-   Matrices.model = glm::mat4(1.0f);
-  translateText = glm::translate(glm::vec3(-3, 0,0));
-  scaleText = glm::scale(glm::vec3(fontScaleValue*4,fontScaleValue*4,fontScaleValue*4));
-  Matrices.model *= (translateText);
-  MVP = Matrices.projection * Matrices.view * Matrices.model;
 
-  // send font's MVP and font color to fond shaders
-  glUniformMatrix4fv(GL3Font.fontMatrixID, 1, GL_FALSE, &MVP[0][0]);
-  glUniform3fv(GL3Font.fontColorID, 1, &glm::vec3(0.6,0.6,0.6)[0]);
-  snprintf(buffer, sizeof(buffer), "%s", "CHOOSE YOUR KINGDOM!");
-  GL3Font.font->Render(buffer);
-    Matrices.model = glm::mat4(1.0f);
-  translateText = glm::translate(glm::vec3(-10, -1,0));
-  scaleText = glm::scale(glm::vec3(fontScaleValue,fontScaleValue,fontScaleValue));
-  Matrices.model *= (translateText);
-  MVP = Matrices.projection * Matrices.view * Matrices.model;
-
-  // send font's MVP and font color to fond shaders
-  glUniformMatrix4fv(GL3Font.fontMatrixID, 1, GL_FALSE, &MVP[0][0]);
-  glUniform3fv(GL3Font.fontColorID, 1, &glm::vec3(0.2,0.2,0.2)[0]);
-  snprintf(buffer, sizeof(buffer), "%s", "1       2       3       4       5       6       7       8       9");
-  GL3Font.font->Render(buffer);
+void writeMessage(const char *text, float x, float y) {
+  glUseProgram(fontProgramID);
+  renderText(text, x, y, getRGBfromHue (fontScale));
 }
-  fontScale = (fontScale + 1) % 360;
 
+void writeMenuTexts() {
+  glUseProgram(fontProgramID);
+  renderText("CHOOSE YOUR KINGDOM!", -3, 0, glm::vec3(0.6,0.6,0.6));
+  renderText("1       2       3       4       5       6       7       8       9", -10, -1, glm::vec3(0.2,0.2,0.2));
 }
 
 
 
 float camera_rotation_angle = 90;
 
-/* Render the scene with openGL */
-/* Edit this function according to your assignment */
-void draw ()
-{
-   obsY += obsFlag;
-    if(obsY > 5) obsFlag = -0.01;
-    else if(obsY < 4) obsFlag = 0.01;
-  if(glfwGetTime() - loseTime > 4 && playerLose) gameResetAfterLoss();
-
-  static int frames = 0;
-  if(onMenu == false)
- {  drawFall();
-  drawJump();
-  updateObstacles();
-  updateBlockMotion();
-  drawMove();
-}
+/* Camera of the current view, the adventure and follow-cam views go with
+   the player */
+void updateCamera(const Game &g) {
+  const Entities &e = g.entities;
+  float playerCoordX = e.x[playerEntity], playerCoordY = e.y[playerEntity], playerCoordZ = e.z[playerEntity];
   float alpha = 0, beta = 0;
 
-  // clear the color and depth in the frame buffer
-  glClear (GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
-  // Matrices.view = glm::lookAt(glm::vec3(0,0,10), glm::vec3(0,0,0), glm::vec3(0,1,0));
-  // drawBackground();
-
-  // use the loaded shader program
-  // Don't change unless you know what you are doing
-  glUseProgram (programID);
   viewsX[3][0] = playerCoordX, viewsZ[3][0] = playerCoordZ, viewsY[3][0] = playerCoordY + 4;
   viewsY[2][0] = playerCoordY + 10;
 
 
-  if(playerDirection == 1) {
+  if(g.playerDirection == 1) {
     viewsX[2][0] = playerCoordX - 4, viewsZ[2][0] = playerCoordZ;
     alpha = 2;
   }
-  else if(playerDirection == 2) {
+  else if(g.playerDirection == 2) {
     viewsX[2][0] = playerCoordX + 4, viewsZ[2][0] = playerCoordZ;
     alpha = -2;
   }
 
-  if(playerDirection == 3) {
+  if(g.playerDirection == 3) {
     viewsZ[2][0] = playerCoordZ - 4, viewsX[2][0] = playerCoordX;
     beta = 2;
   }
-  if(playerDirection == 4) {
+  if(g.playerDirection == 4) {
     viewsZ[2][0] = playerCoordZ + 4, viewsX[2][0] = playerCoordX;
     beta = -2;
   }
@@ -1838,10 +1378,10 @@ void draw ()
   eyeZ = viewsZ[currentView][viewPtr[currentView]];
   if(currentView == 0 or currentView == 1) eyeY += zoom_flag;
   else if(currentView == 2 or currentView == 3 and zoom_flag < 4 and zoom_flag >-4) {
-    if(playerDirection == 1) eyeX -= zoom_flag;
-    if(playerDirection == 2) eyeX += zoom_flag;
-    if(playerDirection == 3) eyeZ -= zoom_flag;
-    if(playerDirection == 4) eyeZ += zoom_flag;
+    if(g.playerDirection == 1) eyeX -= zoom_flag;
+    if(g.playerDirection == 2) eyeX += zoom_flag;
+    if(g.playerDirection == 3) eyeZ -= zoom_flag;
+    if(g.playerDirection == 4) eyeZ += zoom_flag;
 
   }
 
@@ -1869,20 +1409,22 @@ void draw ()
 
   else
     Matrices.view = glm::lookAt( eye, target, up ); // Rotating Camera for 3D
+}
 
-  //  Don't change unless you are sure!!
+/* The board, the player and everything on it, seen by the camera */
+void drawWorld(const Game &g) {
+  const Entities &e = g.entities;
 
-  //static float c = 0;
-  //c++;
-  //Matrices.view = glm::lookAt(glm::vec3(0,0,10), glm::vec3(0,0,0), glm::vec3(0,1,0));
-  // Compute ViewProject matrix as view/camera might not be changed for this frame (basic scenario)
-  //  Don't change unless you are sure!!
+  // Player and moving block positions for the scene, one pass over the store
+  float playerCoordX = e.x[playerEntity], playerCoordY = e.y[playerEntity], playerCoordZ = e.z[playerEntity];
+  int playerX = e.cellX[playerEntity], playerZ = e.cellZ[playerEntity];
+  float cellY[10][10] = {};
+  for(int n = 0; n < e.count; n++) if(e.kind[n] == ENTITY_BLOCK) cellY[e.cellX[n]][e.cellZ[n]] = e.y[n];
+
+  static int frames = 0;
+  glUseProgram (programID);
   glm::mat4 VP = Matrices.projection * Matrices.view;
 
-  // Send our transformation to the currently bound shader, in the "MVP" uniform
-  // For each model you render, since the MVP will be different (at least the M part)
-  //  Don't change unless you are sure!!
-if(onMenu == false) {
   drawBackground();
   glm::mat4 translateCube;
   glm::mat4 rotateCube;
@@ -1926,10 +1468,7 @@ if(onMenu == false) {
     for(int j = 0; j<10; j++) {
       Matrices.model = glm::mat4(1.0f);
       /* Render your scene */
-      if(!isMoving[i][j])
-        translateCube = glm::translate (glm::vec3(i*2+shiftX, 0, j*2+shiftZ)); // glTranslatef
-      else
-        translateCube = glm::translate (glm::vec3(i*2+shiftX, blockCoordY, j*2+shiftZ)); // glTranslatef
+      translateCube = glm::translate (glm::vec3(i*2+shiftX, cellY[i][j], j*2+shiftZ)); // glTranslatef
 
       glm::mat4 CubeTransform = translateCube;
 
@@ -1941,7 +1480,7 @@ if(onMenu == false) {
       glUniformMatrix4fv(Matrices.MatrixID, 1, GL_FALSE, &MVP[0][0]);
 
       // draw3DObject draws the VAO given to it using current MVP matrix
-      if(isPresent[i][j]) {
+      if(g.isPresent.test(i, j)) {
         draw3DObject(cube);
 
         glUseProgram (textureProgramID);
@@ -1949,19 +1488,18 @@ if(onMenu == false) {
         VP = Matrices.projection * Matrices.view;
         MVP;  // MVP = Projection * View * Model
         Matrices.model = glm::mat4(1.0f);
-        if(!isMoving[i][j]) translateRectangle = glm::translate (glm::vec3(i*2+shiftX, 3.05, j*2+shiftZ));
-        else translateRectangle = glm::translate (glm::vec3(i*2+shiftX, blockCoordY+3.05, j*2+shiftZ));
+        translateRectangle = glm::translate (glm::vec3(i*2+shiftX, cellY[i][j]+3.05, j*2+shiftZ));
         rotateRectangle = glm::rotate((float)(-90*M_PI/180.0f), glm::vec3(1,0,0)); // glTranslatef
         Matrices.model *= (translateRectangle * rotateRectangle);
         MVP = VP * Matrices.model;
         glUniformMatrix4fv(Matrices.TexMatrixID, 1, GL_FALSE, &MVP[0][0]);
         glUniform1i(glGetUniformLocation(textureProgramID, "texSampler"), 0); 
         if(i==j || i+j==9) 
-                draw3DTexturedObject(sigil[playerHouse]);
+                draw3DTexturedObject(sigil[g.playerHouse]);
 
 
         else if(lightOn == true) {
-          if(playerDirection == 1) {
+          if(g.playerDirection == 1) {
             if(i-playerX<=2 && i>=playerX && playerZ >= j-1 && playerZ <= j+1) {
               if((i+j )% 2) 
                 draw3DTexturedObject(grass);
@@ -1970,7 +1508,7 @@ if(onMenu == false) {
             }
             else draw3DTexturedObject(square[(i+j)%2]);
           }
-          else if(playerDirection == 2) {
+          else if(g.playerDirection == 2) {
             if(i-playerX>=-2 && i<=playerX && playerZ >= j-1 && playerZ <= j+1) {
               if((i+j )% 2) 
                 draw3DTexturedObject(grass);
@@ -1981,7 +1519,7 @@ if(onMenu == false) {
 
 
           }
-          else if(playerDirection == 3) {
+          else if(g.playerDirection == 3) {
             if(j-playerZ<=2 && j>=playerZ && playerX >= i-1 && playerX <= i+1) {
               if((i+j )% 2) 
                 draw3DTexturedObject(grass);
@@ -2013,13 +1551,13 @@ if(onMenu == false) {
 
 
         Matrices.model = glm::mat4(1.0f);
-        translateCube = glm::translate (glm::vec3(playerCoordX, playerCoordY+playerWin*3+1.5, playerCoordZ)); // glTranslatef
+        translateCube = glm::translate (glm::vec3(playerCoordX, playerCoordY+g.playerWin*3+1.5, playerCoordZ)); // glTranslatef
         rotateCube = glm::rotate((float)(sphereRotation*M_PI/180.0f), glm::vec3(0,0,1)); // glTranslatef
         glm::mat4 rotateCube2 = glm::rotate((float)(sphereRotation*M_PI/180.0f), glm::vec3(0,1,0)); // glTranslatef
 
         glm::mat4 CubeTransform = translateCube;
-        if(playerAnimate || playerFallOff || playerJumpUp || playerJumpRight || playerJumpLeft || playerJumpDown) CubeTransform *= rotateCube;
-        if(playerWin) CubeTransform *= rotateCube2;
+        if(g.playerAnimate || g.playerFallOff || g.playerJumpUp || g.playerJumpRight || g.playerJumpLeft || g.playerJumpDown) CubeTransform *= rotateCube;
+        if(g.playerWin) CubeTransform *= rotateCube2;
 
         Matrices.model *= CubeTransform;
         MVP = VP * Matrices.model; // MVP = p * V * M
@@ -2027,10 +1565,10 @@ if(onMenu == false) {
         //  Don't change unless you are sure!!
         // Copy MVP to normal shaders
         glUniformMatrix4fv(Matrices.MatrixID, 1, GL_FALSE, &MVP[0][0]);
-        if(!playerAnimate) {
+        if(!g.playerAnimate) {
           draw3DObject(player); 
           Matrices.model = glm::mat4(1.0f);
-          translateCube = glm::translate (glm::vec3(playerCoordX, playerCoordY+3+playerWin*3, playerCoordZ)); // glTranslatef
+          translateCube = glm::translate (glm::vec3(playerCoordX, playerCoordY+3+g.playerWin*3, playerCoordZ)); // glTranslatef
 
 
           CubeTransform = translateCube;
@@ -2045,7 +1583,7 @@ if(onMenu == false) {
           // draw3DObject draws the VAO given to it using current MVP matrix
           draw3DObject(head);
           Matrices.model = glm::mat4(1.0f);
-          translateCube = glm::translate (glm::vec3(playerCoordX, playerCoordY+3+playerWin*3+0.3, playerCoordZ)); // glTranslatef
+          translateCube = glm::translate (glm::vec3(playerCoordX, playerCoordY+3+g.playerWin*3+0.3, playerCoordZ)); // glTranslatef
 
 
           CubeTransform = translateCube;
@@ -2060,13 +1598,13 @@ if(onMenu == false) {
           // draw3DObject draws the VAO given to it using current MVP matrix
           draw3DObject(eyes);
           Matrices.model = glm::mat4(1.0f);
-          if(playerDirection == 3 or playerDirection == 4) {
-            translateCube = glm::translate (glm::vec3(playerCoordX-0.5, playerCoordY+playerWin*3, playerCoordZ)); // glTranslatef
+          if(g.playerDirection == 3 or g.playerDirection == 4) {
+            translateCube = glm::translate (glm::vec3(playerCoordX-0.5, playerCoordY+g.playerWin*3, playerCoordZ)); // glTranslatef
 
             rotateCube = glm::rotate((float)(-20*M_PI/180.0f), glm::vec3(0,0,1)); // glTranslatef
           }
           else {
-            translateCube = glm::translate (glm::vec3(playerCoordX, playerCoordY+playerWin*3, playerCoordZ-0.5)); // glTranslatef
+            translateCube = glm::translate (glm::vec3(playerCoordX, playerCoordY+g.playerWin*3, playerCoordZ-0.5)); // glTranslatef
             rotateCube = glm::rotate((float)(30*M_PI/180.0f), glm::vec3(1,0,0)); // glTranslatef
 
           }
@@ -2084,12 +1622,12 @@ if(onMenu == false) {
           // draw3DObject draws the VAO given to it using current MVP matrix
           draw3DObject(limbs);
           Matrices.model = glm::mat4(1.0f);
-          if(playerDirection == 3 or playerDirection == 4) {
-            translateCube = glm::translate (glm::vec3(playerCoordX+0.5, playerCoordY+playerWin*3, playerCoordZ)); // glTranslatef
+          if(g.playerDirection == 3 or g.playerDirection == 4) {
+            translateCube = glm::translate (glm::vec3(playerCoordX+0.5, playerCoordY+g.playerWin*3, playerCoordZ)); // glTranslatef
             rotateCube = glm::rotate((float)(20*M_PI/180.0f), glm::vec3(0,0,1)); // glTranslatef
           }
           else {
-            translateCube = glm::translate (glm::vec3(playerCoordX, playerCoordY+playerWin*3, playerCoordZ+0.5)); // glTranslatef
+            translateCube = glm::translate (glm::vec3(playerCoordX, playerCoordY+g.playerWin*3, playerCoordZ+0.5)); // glTranslatef
             rotateCube = glm::rotate((float)(150*M_PI/180.0f), glm::vec3(1,0,0)); // glTranslatef
 
           }
@@ -2106,13 +1644,13 @@ if(onMenu == false) {
           // draw3DObject draws the VAO given to it using current MVP matrix
           draw3DObject(limbs);
           Matrices.model = glm::mat4(1.0f);
-          if(playerDirection == 3 or playerDirection == 4) {
-            translateCube = glm::translate (glm::vec3(playerCoordX+1, playerCoordY+2+playerWin*3, playerCoordZ)); // glTranslatef
+          if(g.playerDirection == 3 or g.playerDirection == 4) {
+            translateCube = glm::translate (glm::vec3(playerCoordX+1, playerCoordY+2+g.playerWin*3, playerCoordZ)); // glTranslatef
 
             rotateCube = glm::rotate((float)(50*M_PI/180.0f), glm::vec3(0,0,1)); // glTranslatef
           }
           else {
-            translateCube = glm::translate (glm::vec3(playerCoordX, playerCoordY+2+playerWin*3, playerCoordZ+1)); // glTranslatef
+            translateCube = glm::translate (glm::vec3(playerCoordX, playerCoordY+2+g.playerWin*3, playerCoordZ+1)); // glTranslatef
             rotateCube = glm::rotate((float)(110*M_PI/180.0f), glm::vec3(1,0,0)); // glTranslatef
 
           }
@@ -2128,13 +1666,13 @@ if(onMenu == false) {
           // draw3DObject draws the VAO given to it using current MVP matrix
           draw3DObject(limbs);
           Matrices.model = glm::mat4(1.0f);
-          if(playerDirection == 3 or playerDirection == 4)  {
-            translateCube = glm::translate (glm::vec3(playerCoordX-1, playerCoordY+2+playerWin*3, playerCoordZ)); // glTranslatef
+          if(g.playerDirection == 3 or g.playerDirection == 4)  {
+            translateCube = glm::translate (glm::vec3(playerCoordX-1, playerCoordY+2+g.playerWin*3, playerCoordZ)); // glTranslatef
 
             rotateCube = glm::rotate((float)(-50*M_PI/180.0f), glm::vec3(0,0,1)); // glTranslatef
           }
           else {
-            translateCube = glm::translate (glm::vec3(playerCoordX, playerCoordY+2+playerWin*3, playerCoordZ-1)); // glTranslatef
+            translateCube = glm::translate (glm::vec3(playerCoordX, playerCoordY+2+g.playerWin*3, playerCoordZ-1)); // glTranslatef
             rotateCube = glm::rotate((float)(-110*M_PI/180.0f), glm::vec3(1,0,0)); // glTranslatef
 
           }
@@ -2157,7 +1695,7 @@ if(onMenu == false) {
           if(frames == 10) {
             draw3DObject(player);
             Matrices.model = glm::mat4(1.0f);
-            translateCube = glm::translate (glm::vec3(playerCoordX, playerCoordY+3+playerWin*3, playerCoordZ)); // glTranslatef
+            translateCube = glm::translate (glm::vec3(playerCoordX, playerCoordY+3+g.playerWin*3, playerCoordZ)); // glTranslatef
 
 
             CubeTransform = translateCube;
@@ -2172,7 +1710,7 @@ if(onMenu == false) {
             // draw3DObject draws the VAO given to it using current MVP matrix
             draw3DObject(head);
            Matrices.model = glm::mat4(1.0f);
-          translateCube = glm::translate (glm::vec3(playerCoordX, playerCoordY+3+playerWin*3+0.3, playerCoordZ)); // glTranslatef
+          translateCube = glm::translate (glm::vec3(playerCoordX, playerCoordY+3+g.playerWin*3+0.3, playerCoordZ)); // glTranslatef
 
 
           CubeTransform = translateCube;
@@ -2188,13 +1726,13 @@ if(onMenu == false) {
           draw3DObject(eyes);
           // draw3DObject draws the VAO given to it using
             Matrices.model = glm::mat4(1.0f);
-            if(playerDirection == 3 or playerDirection == 4) {
-              translateCube = glm::translate (glm::vec3(playerCoordX-0.5, playerCoordY+playerWin*3, playerCoordZ)); // glTranslatef
+            if(g.playerDirection == 3 or g.playerDirection == 4) {
+              translateCube = glm::translate (glm::vec3(playerCoordX-0.5, playerCoordY+g.playerWin*3, playerCoordZ)); // glTranslatef
 
               rotateCube = glm::rotate((float)(-20*M_PI/180.0f), glm::vec3(0,0,1)); // glTranslatef
             }
             else {
-              translateCube = glm::translate (glm::vec3(playerCoordX, playerCoordY+playerWin*3, playerCoordZ-0.5)); // glTranslatef
+              translateCube = glm::translate (glm::vec3(playerCoordX, playerCoordY+g.playerWin*3, playerCoordZ-0.5)); // glTranslatef
               rotateCube = glm::rotate((float)(30*M_PI/180.0f), glm::vec3(1,0,0)); // glTranslatef
 
             }
@@ -2212,12 +1750,12 @@ if(onMenu == false) {
             // draw3DObject draws the VAO given to it using current MVP matrix
             draw3DObject(limbs);
             Matrices.model = glm::mat4(1.0f);
-            if(playerDirection == 3 or playerDirection == 4) {
-              translateCube = glm::translate (glm::vec3(playerCoordX+0.5, playerCoordY+playerWin*3, playerCoordZ)); // glTranslatef
+            if(g.playerDirection == 3 or g.playerDirection == 4) {
+              translateCube = glm::translate (glm::vec3(playerCoordX+0.5, playerCoordY+g.playerWin*3, playerCoordZ)); // glTranslatef
               rotateCube = glm::rotate((float)(20*M_PI/180.0f), glm::vec3(0,0,1)); // glTranslatef
             }
             else {
-              translateCube = glm::translate (glm::vec3(playerCoordX, playerCoordY+playerWin*3, playerCoordZ+0.5)); // glTranslatef
+              translateCube = glm::translate (glm::vec3(playerCoordX, playerCoordY+g.playerWin*3, playerCoordZ+0.5)); // glTranslatef
               rotateCube = glm::rotate((float)(150*M_PI/180.0f), glm::vec3(1,0,0)); // glTranslatef
 
             }
@@ -2234,13 +1772,13 @@ if(onMenu == false) {
             // draw3DObject draws the VAO given to it using current MVP matrix
             draw3DObject(limbs);
             Matrices.model = glm::mat4(1.0f);
-            if(playerDirection == 3 or playerDirection == 4) {
-              translateCube = glm::translate (glm::vec3(playerCoordX+1, playerCoordY+2+playerWin*3, playerCoordZ)); // glTranslatef
+            if(g.playerDirection == 3 or g.playerDirection == 4) {
+              translateCube = glm::translate (glm::vec3(playerCoordX+1, playerCoordY+2+g.playerWin*3, playerCoordZ)); // glTranslatef
 
               rotateCube = glm::rotate((float)(50*M_PI/180.0f), glm::vec3(0,0,1)); // glTranslatef
             }
             else {
-              translateCube = glm::translate (glm::vec3(playerCoordX, playerCoordY+2+playerWin*3, playerCoordZ+1)); // glTranslatef
+              translateCube = glm::translate (glm::vec3(playerCoordX, playerCoordY+2+g.playerWin*3, playerCoordZ+1)); // glTranslatef
               rotateCube = glm::rotate((float)(110*M_PI/180.0f), glm::vec3(1,0,0)); // glTranslatef
 
             }
@@ -2256,13 +1794,13 @@ if(onMenu == false) {
             // draw3DObject draws the VAO given to it using current MVP matrix
             draw3DObject(limbs);
             Matrices.model = glm::mat4(1.0f);
-            if(playerDirection == 3 or playerDirection == 4)  {
-              translateCube = glm::translate (glm::vec3(playerCoordX-1, playerCoordY+2+playerWin*3, playerCoordZ)); // glTranslatef
+            if(g.playerDirection == 3 or g.playerDirection == 4)  {
+              translateCube = glm::translate (glm::vec3(playerCoordX-1, playerCoordY+2+g.playerWin*3, playerCoordZ)); // glTranslatef
 
               rotateCube = glm::rotate((float)(-50*M_PI/180.0f), glm::vec3(0,0,1)); // glTranslatef
             }
             else {
-              translateCube = glm::translate (glm::vec3(playerCoordX, playerCoordY+2+playerWin*3, playerCoordZ-1)); // glTranslatef
+              translateCube = glm::translate (glm::vec3(playerCoordX, playerCoordY+2+g.playerWin*3, playerCoordZ-1)); // glTranslatef
               rotateCube = glm::rotate((float)(-110*M_PI/180.0f), glm::vec3(1,0,0)); // glTranslatef
 
             }
@@ -2279,10 +1817,6 @@ if(onMenu == false) {
             // draw3DObject draws the VAO given to it using current MVP matrix
             draw3DObject(limbs);
             frames = 0;
-            if(glfwGetTime() - timeStamp > 2.5) {
-              playerAnimate = false;
-              playerReset(2);
-            }
           }
         }
       }
@@ -2290,12 +1824,11 @@ if(onMenu == false) {
   }
 
 
-  for(int l=0; l<obstacles.size(); l++) {
-    int i=obstacles[l].first;
-    int j=obstacles[l].second;
+  for(int l=0; l<e.count; l++) {
+    if(e.kind[l] != ENTITY_OBSTACLE) continue;
 
     Matrices.model = glm::mat4(1.0f);
-    translateCube = glm::translate (glm::vec3(i*2+shiftX, obsY, j*2+shiftZ)); // glTranslatef
+    translateCube = glm::translate (glm::vec3(e.x[l], e.y[l], e.z[l])); // glTranslatef
     rotateCube = glm::rotate((float)(sphereRotation*M_PI/180.0f), glm::vec3(0,0,1)); // glTranslatef
 
     glm::mat4 CubeTransform = translateCube * rotateCube;
@@ -2312,12 +1845,11 @@ if(onMenu == false) {
     draw3DObject(spikes);
   }
 
-  for(int l=0; l<coins.size(); l++) {
-    int i=coins[l].first;
-    int j=coins[l].second;
+  for(int l=0; l<e.count; l++) {
+    if(e.kind[l] != ENTITY_COIN) continue;
 
     Matrices.model = glm::mat4(1.0f);
-    translateCube = glm::translate (glm::vec3(i*2+shiftX, 4.2, j*2+shiftZ));
+    translateCube = glm::translate (glm::vec3(e.x[l], e.y[l], e.z[l]));
     rotateCube = glm::rotate((float)((-sphereRotation+90)*M_PI/180.0f), glm::vec3(0,0,1)); // glTranslatef
 
 
@@ -2333,22 +1865,185 @@ if(onMenu == false) {
     // draw3DObject draws the VAO given to it using current MVP matrix
     draw3DObject(coin);
   }
+
+  // Other players in a LAN game
+  for(int l=0; l<e.count; l++) {
+    if(e.kind[l] != ENTITY_PLAYER || l == playerEntity) continue;
+
+    Matrices.model = glm::mat4(1.0f);
+    translateCube = glm::translate (glm::vec3(e.x[l], e.y[l]+1.5, e.z[l]));
+    Matrices.model *= translateCube;
+    MVP = VP * Matrices.model; // MVP = p * V * M
+    glUniformMatrix4fv(Matrices.MatrixID, 1, GL_FALSE, &MVP[0][0]);
+    draw3DObject(player);
+  }
 }
+
+/* Speed, lives, points and the clock over the world, from a fixed camera */
+void drawOverlay(const Game &g) {
   Matrices.view = glm::lookAt(glm::vec3(0,0,10), glm::vec3(0,0,0), glm::vec3(0,1,0));
- if(onMenu == false)  {
-  drawSpeedy();
-  drawTimer();
-  drawStars();
-  drawLives();
+  drawSpeedy(g);
+  drawHUD();
+
+
+  if(g.starAnimate) drawAnimate(g, star);
+  if(g.heartAnimate) drawAnimate(g, heart);
+  writeHUDTexts(g);
+}
+
+/* The lazy sprite arrays the current view shows are loaded whole on the
+   way in, rather than streamed in while they are on screen */
+void enterWorld(const Game &g) {
+  if(soldierVisible()) preloadSpriteArray(ARRAY_SOLDIER);
+  if(dragonVisible()) preloadSpriteArray(ARRAY_DRAGON);
+}
+
+void drawMenuScene() {
+  Matrices.view = glm::lookAt(glm::vec3(0,0,10), glm::vec3(0,0,0), glm::vec3(0,1,0));
+  writeMenuTexts();
+  drawMenu();
+}
+
+/* Nothing on the menu moves, so it is drawn once into a texture of the
+   framebuffer's size and shown as a single quad after that. A new window
+   size draws it again */
+GLuint menuFramebuffer = 0, menuDepth = 0, menuTexture = 0;
+int menuWidth = 0, menuHeight = 0; // of menuTexture, 0 before it is drawn
+bool menuCacheFailed = false;      // no complete framebuffer, draw the menu every frame
+VAO *menuQuad = NULL;              // the whole viewport, textured with menuTexture
+const double menuWaitTime = 0.25;  // seconds the menu sleeps without input, between shader checks
+
+void cacheMenu(int width, int height) {
+  if(menuFramebuffer == 0) {
+    glGenFramebuffers(1, &menuFramebuffer);
+    glGenRenderbuffers(1, &menuDepth);
+    glGenTextures(1, &menuTexture);
+    static const GLfloat corners[] = { -1,-1,0, 1,-1,0, 1,1,0, -1,-1,0, 1,1,0, -1,1,0 };
+    static const GLfloat uv[] = { 0,0, 1,0, 1,1, 0,0, 1,1, 0,1 };
+    menuQuad = create3DTexturedObject(GL_TRIANGLES, 6, corners, uv, menuTexture, GL_FILL);
+  }
+  else untrackTexture(menuTexture);
+
+  glBindTexture(GL_TEXTURE_2D, menuTexture);
+  glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_NEAREST);
+  glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_NEAREST);
+  glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
+  glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
+  glTexImage2D(GL_TEXTURE_2D, 0, GL_RGB8, width, height, 0, GL_RGB, GL_UNSIGNED_BYTE, NULL);
+  glBindTexture(GL_TEXTURE_2D, 0);
+  trackTexture(menuTexture, "menu", width, height, 1, 1, GL_RGB8);
+  glBindRenderbuffer(GL_RENDERBUFFER, menuDepth);
+  glRenderbufferStorage(GL_RENDERBUFFER, GL_DEPTH_COMPONENT24, width, height);
+  glBindRenderbuffer(GL_RENDERBUFFER, 0);
+
+  glBindFramebuffer(GL_FRAMEBUFFER, menuFramebuffer);
+  glFramebufferTexture2D(GL_FRAMEBUFFER, GL_COLOR_ATTACHMENT0, GL_TEXTURE_2D, menuTexture, 0);
+  glFramebufferRenderbuffer(GL_FRAMEBUFFER, GL_DEPTH_ATTACHMENT, GL_RENDERBUFFER, menuDepth);
+  if(glCheckFramebufferStatus(GL_FRAMEBUFFER) != GL_FRAMEBUFFER_COMPLETE) {
+    cout << "Menu framebuffer incomplete, the menu is drawn every frame" << endl;
+    menuCacheFailed = true;
+  }
+  else {
+    glClear (GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
+    drawMenuScene();
+    menuWidth = width, menuHeight = height;
+  }
+  glBindFramebuffer(GL_FRAMEBUFFER, 0);
+}
+
+/* Drawn ahead, so the first frame of the menu is already the cheap one */
+void enterMenu(const Game &g) {
+  if(!menuCacheFailed && (menuWidth != framebufferWidth || menuHeight != framebufferHeight)) cacheMenu(framebufferWidth, framebufferHeight);
+}
 
+void renderMenu(const Game &g) {
+  enterMenu(g);
+  if(menuCacheFailed) {
+    drawMenuScene();
+    return;
+  }
+  glUseProgram (textureProgramID);
+  glm::mat4 MVP = glm::mat4(1.0f); // the quad is in clip space
+  glUniformMatrix4fv(Matrices.TexMatrixID, 1, GL_FALSE, &MVP[0][0]);
+  glUniform1i(glGetUniformLocation(textureProgramID, "texSampler"), 0);
+  draw3DTexturedObject(menuQuad);
+}
 
-  if(starAnimate) drawAnimate(star);
-  if(heartAnimate) drawAnimate(heart);
+/* onProgramsReloaded: new uniform locations, and the cached menu was drawn
+   with the old programs */
+void programsReloaded() {
+  getUniformLocations();
+  menuWidth = menuHeight = 0;
+  screenDamaged = true;
 }
 
+void renderPlaying(const Game &g) {
+  drawWorld(g);
+  drawOverlay(g);
+}
+
+void renderWon(const Game &g) {
+  renderPlaying(g);
+  writeMessage("Congratulations!", -2, 4);
+}
+
+void renderLost(const Game &g) {
+  renderPlaying(g);
+  writeMessage("You lose!", -1, 4);
+}
+
+/* What the renderer does in each state of gameState(). 'enter' runs on the
+   first frame in a state, 'update' and 'render' on every frame, NULL hooks
+   are skipped. The menu never touches the world */
+struct StateHooks {
+  void (*enter)(const Game &g);
+  void (*update)(const Game &g);
+  void (*render)(const Game &g);
+};
+
+const StateHooks stateHooks[NUM_GAME_STATES] = {
+  { enterMenu,  NULL,         renderMenu },    // STATE_MENU
+  { enterWorld, updateCamera, renderPlaying }, // STATE_PLAYING
+  { enterWorld, updateCamera, renderPlaying }, // STATE_DYING, the player blinks or falls
+  { enterWorld, updateCamera, renderWon },     // STATE_WON
+  { enterWorld, updateCamera, renderLost }     // STATE_LOST
+};
+
+int screenState = -1; // the state of the last frame drawn
+int drawnWidth = 0, drawnHeight = 0; // framebuffer size of the last frame drawn
+
+/* The menu is a still image, it is only drawn again for a new framebuffer
+   size or when the window lost its contents. Every other state moves */
+bool frameNeeded() {
+  if(screenState != STATE_MENU || gameState(latestSnapshot()) != STATE_MENU) return true;
+  return screenDamaged || drawnWidth != framebufferWidth || drawnHeight != framebufferHeight;
+}
+
+/* Render the scene with openGL */
+/* Only reads the latest snapshot, the rules run on the simulation thread */
+void draw ()
+{
+  const Game &g = latestSnapshot();
+
+  // Sprite frames are selected on the GPU from this clock
+  animClock = glfwGetTime();
+  evictSpriteArrays();
+
+  int state = gameState(g);
+  if(state != screenState) {
+    screenState = state;
+    if(stateHooks[state].enter) stateHooks[state].enter(g);
+  }
+
+  // clear the color and depth in the frame buffer
+  glClear (GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
+  if(stateHooks[state].update) stateHooks[state].update(g);
+  stateHooks[state].render(g);
+
   sphereRotation++;
-  writeTexts();
-  if(onMenu) drawMenu();
+  fontScale = (fontScale + 1) % 360;
+  drawnWidth = framebufferWidth, drawnHeight = framebufferHeight;
+  screenDamaged = false;
 }
 
 /* Initialise glfw window, I/O callbacks and the renderer to use */
@@ -2359,7 +2054,7 @@ int main (int argc, char** argv)
 {
   ALboolean enumeration;
   const ALCchar *devices;
-  const ALCchar *defaultDeviceName = argv[1];
+  const ALCchar *defaultDeviceName = NULL;
   int ret;
 #ifdef LIBAUDIO
   WaveInfo *wave;
@@ -2376,6 +2071,61 @@ int main (int argc, char** argv)
   ALCenum error;
   ALint source_state;
 
+  // Options first, anything else names the audio device
+  const char *recordFile = NULL, *replayFile = NULL, *joinAddress = NULL;
+  bool headless = false;
+  int evaluateBoards = 0, evaluateLevels = 10, benchActors = 0, benchWaves = 0, soakBots = 0, serveSessions = 0, hostPort = 0;
+  double serveSeconds = 0;
+  vector<int> holeOdds(1, defaultDensity.holes), movingOdds(1, defaultDensity.moving);
+  gameSeed = time(NULL);
+  for(int i = 1; i < argc; i++) {
+    if(!strcmp(argv[i], "--texture-budget") && i+1 < argc) textureBudget = (size_t)atoi(argv[++i]) << 20;
+    else if(!strcmp(argv[i], "--compress-textures")) compressTextures = true;
+    else if(!strcmp(argv[i], "--seed") && i+1 < argc) gameSeed = strtoul(argv[++i], NULL, 10);
+    else if(!strcmp(argv[i], "--record") && i+1 < argc) recordFile = argv[++i];
+    else if(!strcmp(argv[i], "--replay") && i+1 < argc) replayFile = argv[++i];
+    else if(!strcmp(argv[i], "--replay-speed") && i+1 < argc) replaySpeed = strcmp(argv[++i], "max") ? atof(argv[i]) : 0;
+    else if(!strcmp(argv[i], "--time-scale") && i+1 < argc) timeScale = max(atof(argv[++i]), 0.01);
+    else if(!strcmp(argv[i], "--tick-rate") && i+1 < argc) setTickRate(max(atoi(argv[++i]), 1));
+    else if(!strcmp(argv[i], "--headless")) headless = true;
+    else if(!strcmp(argv[i], "--evaluate") && i+1 < argc) evaluateBoards = atoi(argv[++i]);
+    else if(!strcmp(argv[i], "--levels") && i+1 < argc) evaluateLevels = atoi(argv[++i]);
+    else if(!strcmp(argv[i], "--hole-odds") && i+1 < argc) holeOdds = parseList(argv[++i]);
+    else if(!strcmp(argv[i], "--moving-odds") && i+1 < argc) movingOdds = parseList(argv[++i]);
+    else if(!strcmp(argv[i], "--bench-broadphase") && i+1 < argc) benchActors = atoi(argv[++i]);
+    else if(!strcmp(argv[i], "--bench-waves") && i+1 < argc) benchWaves = atoi(argv[++i]);
+    else if(!strcmp(argv[i], "--soak") && i+1 < argc) soakBots = atoi(argv[++i]);
+    else if(!strcmp(argv[i], "--bot")) botPlaying = true;
+    else if(!strcmp(argv[i], "--serve") && i+1 < argc) serveSessions = atoi(argv[++i]);
+    else if(!strcmp(argv[i], "--serve-seconds") && i+1 < argc) serveSeconds = atof(argv[++i]);
+    else if(!strcmp(argv[i], "--host") && i+1 < argc) hostPort = atoi(argv[++i]);
+    else if(!strcmp(argv[i], "--join") && i+1 < argc) joinAddress = argv[++i];
+    else defaultDeviceName = argv[i];
+  }
+
+  if(evaluateBoards) return runEvaluation(gameSeed, evaluateBoards, evaluateLevels, holeOdds, movingOdds);
+  if(benchActors) return runBroadphaseBench(benchActors, gameSeed);
+  if(benchWaves) return runWaveBench(benchWaves, gameSeed);
+  if(soakBots) return runSoak(gameSeed, soakBots);
+  if(serveSessions) return runServer(gameSeed, serveSessions, serveSeconds);
+  if(hostPort) return runHost(hostPort, serveSeconds);
+  if(joinAddress) {
+    if(!joinHost(joinAddress)) return -1;
+    if(headless) return runHeadlessClient();
+  }
+
+  if(replayFile) {
+    if(!loadReplay(replayFile, replay)) return -1;
+    setTickRate(replay.tickRate);
+    if(headless) return runHeadlessReplay();
+    replaying = true;
+    gameSeed = replay.seed;
+  }
+  else if(recordFile) {
+    startRecording(recordFile, gameSeed);
+    onInputApplied = recordInput;
+  }
+
   fprintf(stdout, "Using " BACKEND " as audio backend\n");
 
   enumeration = alcIsExtensionPresent(NULL, "ALC_ENUMERATION_EXT");
@@ -2480,6 +2230,13 @@ int main (int argc, char** argv)
 
   initGL (window, width, height);
 
+  seedGame(game, gameSeed);
+  startLevelPipeline(2);
+  prefetchBoards(game.seed, 0, 0); // the first board, level 1
+  onProgramsReloaded = programsReloaded;
+  onMenuLeft = glfwPostEmptyEvent; // wakes the menu's glfwWaitEventsTimeout()
+  startSimulation(joinAddress ? clientLoop : simulationLoop);
+
   double last_update_time = glfwGetTime(), current_time;
 
 
@@ -2488,15 +2245,22 @@ int main (int argc, char** argv)
   /* Draw in loop */
   while (!glfwWindowShouldClose(window)) {
 
-    // OpenGL Draw commands
-    draw();
+    if(frameNeeded()) {
+      // OpenGL Draw commands
+      draw();
 
+      // Swap Frame Buffer in double buffering
+      glfwSwapBuffers(window);
+    }
 
-    // Swap Frame Buffer in double buffering
-    glfwSwapBuffers(window);
+    // Poll for Keyboard and mouse events. The menu shows a still image, it
+    // sleeps until input comes, the simulation leaves it or it is time to
+    // look for edited shaders
+    if(screenState == STATE_MENU) glfwWaitEventsTimeout(menuWaitTime);
+    else glfwPollEvents();
 
-    // Poll for Keyboard and mouse events
-    glfwPollEvents();
+    // Swap in shaders that were edited on disk
+    updateShaderWatch();
 
     // Control based on time (Time based transformation like 5 degrees rotation every 0.5s)
     current_time = glfwGetTime(); // Time in seconds
@@ -2505,6 +2269,8 @@ int main (int argc, char** argv)
       last_update_time = current_time;
     }
   }
+  stopSimulation();
+  stopLevelPipeline();
   alGetSourcei(source, AL_SOURCE_STATE, &source_state);
   TEST_ERROR("source state get");
   while (source_state == AL_PLAYING) {
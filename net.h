@@ -0,0 +1,865 @@
+#ifndef NET_H
+#define NET_H
+
+#include <sys/socket.h>
+#include <netinet/in.h>
+#include <arpa/inet.h>
+#include <netdb.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <thread>
+#include <chrono>
+#include "game.h"
+#include "input.h"
+#include "replay.h"
+#include "simulation.h"
+#include "threads.h"
+
+/* LAN play over UDP. One process hosts (--host PORT) without a window, the
+   players join it (--join HOST:PORT). The host is authoritative: every
+   player has a Game of its own on the host, all with the host's seed, so
+   everyone races over the same boards and sees the others as ghosts.
+   Clients send their key events, the host applies them, steps the games and
+   sends each client a snapshot of what it draws every netSnapshotTicks.
+
+   Snapshots are delta compressed against the last one the client
+   acknowledged: only fields that changed are sent, positions as
+   differences, coins as the ones picked up, obstacles when they are placed
+   anew and blocks only with a new board, their height being a function of
+   time. Moving about costs a client around ten bytes a snapshot. Packets
+   get lost, so the host keeps its recent snapshots to delta from whichever
+   one the client has, and key events are resent until acknowledged.
+
+   A client draws the host's state with the ghosts interpolated between the
+   last two snapshots, and its own player predicted from the keys it holds,
+   a round trip ahead, until the next snapshot corrects it */
+
+const int netMaxPlayers = 8;
+const int netSnapshotTicks = 2;      // 30 snapshots a second at 60 Hz
+const int netHistory = 32;           // snapshots kept for deltas, a power of two
+const double netTimeout = 5;         // seconds of silence before a peer is dropped
+const double netReport = 5;          // seconds between traffic reports
+const int netMaxPacket = 1400;
+const float netUnit = 256;           // positions in 1/256 of a unit
+const unsigned char netVersion = 3;
+
+enum NetMessage {
+  NET_HELLO,     // version
+  NET_WELCOME,   // version, player id, varint seed, varint tick rate
+  NET_INPUT,     // varint snapshot acknowledged + 1, varint first sequence number, varint count, an event a byte
+  NET_SNAPSHOT,  // varint tick, varint baseline + 1 (0 for none), varint last input applied, 2 byte checksum, delta
+  NET_BYE
+};
+
+/* Fields of a delta, a bit each in its mask */
+enum NetField {
+  NET_FLAGS = 1,
+  NET_POSITION = 2,
+  NET_JUMP = 4,
+  NET_SCORE = 8,
+  NET_CLOCK = 16,
+  NET_ANIMATE = 32,
+  NET_BOARD = 64,
+  NET_OBSTACLES = 128,
+  NET_COINS = 256,
+  NET_GHOSTS = 512,
+  NET_ALL = 1023
+};
+
+struct NetBlock {
+  unsigned char cell;          // i*10 + j
+  int baseY, amplitude;        // 1/1024 units
+  int phase, speed;            // 1/65536 cycles and cycles per second
+};
+
+struct NetGhost {
+  int id;
+  int x, y, z;                 // netUnit
+};
+
+/* Everything a client draws, quantized */
+struct NetState {
+  long tick = -1;              // host tick, -1 for none
+  int flags = 0;               // Game booleans, see netFlags
+  int x = 0, y = 0, z = 0;     // netUnit
+  int direction = 3, prevX = 0, prevZ = 0;
+  int level = 1, lives = 3, points = 0, speed = 1, house = 0;
+  int clock = 0;               // currentTime in ticks
+  long respawn = -1;           // host tick of the next respawn(), -1 for none
+  int animateX = 0, animateY = 0; // netUnit
+  long board = 0;              // boardsDrawn
+  Bitboard isPresent = emptyBoard, isMoving = emptyBoard;
+  int blocks = 0;
+  NetBlock block[100];
+  Bitboard obstacles = emptyBoard, coins = emptyBoard;
+  int obstaclePhase[100] = {}; // by cell, of those in 'obstacles', 1/65536 cycles
+  int ghosts = 0;
+  NetGhost ghost[netMaxPlayers];
+};
+
+/* Game booleans as bits of NetState::flags, the rest in this order */
+bool Game::*const netFlags[] = {
+  &Game::onMenu, &Game::playerWin, &Game::playerLose, &Game::playerFall, &Game::playerFallOff,
+  &Game::playerAnimate, &Game::starAnimate, &Game::heartAnimate, &Game::jumpHeld,
+  &Game::playerJumpUp, &Game::playerJumpDown, &Game::playerJumpRight, &Game::playerJumpLeft,
+  &Game::playerMoveUp, &Game::playerMoveDown, &Game::playerMoveRight, &Game::playerMoveLeft
+};
+const int netFlagCount = sizeof(netFlags) / sizeof(netFlags[0]);
+
+int quantize(float v, float unit) {
+  return (int)lroundf(v * unit);
+}
+
+/* The host's view of game 'g' for its player */
+void captureState(const Game &g, NetState &s) {
+  const Entities &e = g.entities;
+  const int p = playerEntity;
+  s.tick = g.tick;
+  s.flags = 0;
+  for(int k = 0; k < netFlagCount; k++) if(g.*netFlags[k]) s.flags |= 1 << k;
+  s.x = quantize(e.x[p], netUnit), s.y = quantize(e.y[p], netUnit), s.z = quantize(e.z[p], netUnit);
+  s.direction = g.playerDirection, s.prevX = g.prevPlayerX, s.prevZ = g.prevPlayerZ;
+  s.level = g.level, s.lives = g.lives, s.points = g.points, s.speed = lroundf(g.speed), s.house = g.playerHouse;
+  s.clock = lround(g.currentTime * tickRate);
+  s.respawn = timerDue(g.timers, TIMER_RESPAWN);
+  s.animateX = quantize(g.animateX, netUnit), s.animateY = quantize(g.animateY, netUnit);
+  s.board = g.boardsDrawn;
+  s.isPresent = g.isPresent, s.isMoving = g.isMoving;
+  s.blocks = 0;
+  s.obstacles = s.coins = emptyBoard;
+  // Blocks in cell order, pickups reorder the store
+  int blockAt[100];
+  for(int c = 0; c < 100; c++) blockAt[c] = -1;
+  for(int n = 0; n < e.count; n++) {
+    if(e.kind[n] == ENTITY_BLOCK) blockAt[e.cellX[n]*10 + e.cellZ[n]] = n;
+    else if(e.kind[n] == ENTITY_OBSTACLE) {
+      s.obstacles.set(e.cellX[n], e.cellZ[n]);
+      s.obstaclePhase[e.cellX[n]*10 + e.cellZ[n]] = quantize(e.phase[n], 65536) & 0xffff;
+    }
+    else if(e.kind[n] == ENTITY_COIN) s.coins.set(e.cellX[n], e.cellZ[n]);
+  }
+  for(int c = 0; c < 100; c++) {
+    int n = blockAt[c];
+    if(n < 0) continue;
+    NetBlock &b = s.block[s.blocks++];
+    b.cell = c;
+    b.baseY = quantize(e.baseY[n], 1024), b.amplitude = quantize(e.amplitude[n], 1024);
+    b.phase = quantize(e.phase[n], 65536) & 0xffff, b.speed = quantize(e.speed[n], 65536);
+  }
+  s.ghosts = 0;
+}
+
+/* Encoding. Signed values are zigzag varints, boards 13 bytes */
+
+void putSigned(vector<unsigned char> &out, long v) {
+  putVarint(out, ((unsigned long)v << 1) ^ (unsigned long)(v >> 63));
+}
+
+bool getSigned(const vector<unsigned char> &in, size_t &pos, long &v) {
+  unsigned long long u;
+  if(!getVarint(in, pos, u)) return false;
+  v = (long)(u >> 1) ^ -(long)(u & 1);
+  return true;
+}
+
+void putBoard(vector<unsigned char> &out, const Bitboard &b) {
+  for(int k = 0; k < 13; k++) out.push_back((unsigned char)(b.w[k >> 3] >> ((k & 7) * 8)));
+}
+
+bool getBoard(const vector<unsigned char> &in, size_t &pos, Bitboard &b) {
+  if(pos + 13 > in.size()) return false;
+  b = emptyBoard;
+  for(int k = 0; k < 13; k++) b.w[k >> 3] |= (uint64_t)in[pos++] << ((k & 7) * 8);
+  return true;
+}
+
+void putCells(vector<unsigned char> &out, const Bitboard &b) {
+  putVarint(out, b.count());
+  for(int c = 0; c < 100; c++) if(b.test(c / 10, c % 10)) out.push_back(c);
+}
+
+bool getCells(const vector<unsigned char> &in, size_t &pos, Bitboard &b) {
+  unsigned long long count;
+  if(!getVarint(in, pos, count) || count > 100 || pos + count > in.size()) return false;
+  b = emptyBoard;
+  for(unsigned k = 0; k < count; k++) {
+    int c = in[pos++];
+    if(c < 100) b.set(c / 10, c % 10);
+  }
+  return true;
+}
+
+const NetGhost *findGhost(const NetState &s, int id) {
+  for(int k = 0; k < s.ghosts; k++) if(s.ghost[k].id == id) return &s.ghost[k];
+  return NULL;
+}
+
+bool sameObstacles(const NetState &a, const NetState &b) {
+  if(!(a.obstacles == b.obstacles)) return false;
+  for(int c = 0; c < 100; c++)
+    if(a.obstacles.test(c / 10, c % 10) && a.obstaclePhase[c] != b.obstaclePhase[c]) return false;
+  return true;
+}
+
+bool sameGhosts(const NetState &a, const NetState &b) {
+  if(a.ghosts != b.ghosts) return false;
+  for(int k = 0; k < a.ghosts; k++) {
+    const NetGhost &g = a.ghost[k], &h = b.ghost[k];
+    if(g.id != h.id || g.x != h.x || g.y != h.y || g.z != h.z) return false;
+  }
+  return true;
+}
+
+/* 's' as changes from 'base', everything when base.tick is -1 */
+void putDelta(vector<unsigned char> &out, const NetState &s, const NetState &base) {
+  int mask = 0;
+  if(base.tick < 0) mask = NET_ALL;
+  else {
+    if(s.flags != base.flags) mask |= NET_FLAGS;
+    if(s.x != base.x || s.y != base.y || s.z != base.z) mask |= NET_POSITION;
+    if(s.direction != base.direction || s.prevX != base.prevX || s.prevZ != base.prevZ) mask |= NET_JUMP;
+    if(s.level != base.level || s.lives != base.lives || s.points != base.points || s.speed != base.speed || s.house != base.house) mask |= NET_SCORE;
+    if(s.clock != base.clock || s.respawn != base.respawn) mask |= NET_CLOCK;
+    if(s.animateX != base.animateX || s.animateY != base.animateY) mask |= NET_ANIMATE;
+    if(s.board != base.board) mask |= NET_BOARD;
+    if(!sameObstacles(s, base)) mask |= NET_OBSTACLES;
+    if(!(s.coins == base.coins)) mask |= NET_COINS;
+    if(!sameGhosts(s, base)) mask |= NET_GHOSTS;
+  }
+  putVarint(out, mask);
+  if(mask & NET_FLAGS) putVarint(out, s.flags);
+  if(mask & NET_POSITION) {
+    putSigned(out, s.x - base.x);
+    putSigned(out, s.y - base.y);
+    putSigned(out, s.z - base.z);
+  }
+  if(mask & NET_JUMP) {
+    putVarint(out, s.direction);
+    putSigned(out, s.prevX);
+    putSigned(out, s.prevZ);
+  }
+  if(mask & NET_SCORE) {
+    putVarint(out, s.level);
+    putVarint(out, s.lives);
+    putVarint(out, s.points);
+    putVarint(out, s.speed);
+    putVarint(out, s.house);
+  }
+  if(mask & NET_CLOCK) {
+    putSigned(out, s.clock - base.clock);
+    putSigned(out, s.respawn - base.respawn);
+  }
+  if(mask & NET_ANIMATE) {
+    putSigned(out, s.animateX - base.animateX);
+    putSigned(out, s.animateY - base.animateY);
+  }
+  if(mask & NET_BOARD) {
+    putVarint(out, s.board);
+    putBoard(out, s.isPresent);
+    putBoard(out, s.isMoving);
+    putVarint(out, s.blocks);
+    for(int k = 0; k < s.blocks; k++) {
+      const NetBlock &b = s.block[k];
+      out.push_back(b.cell);
+      putSigned(out, b.baseY);
+      putSigned(out, b.amplitude);
+      putVarint(out, b.phase);
+      putVarint(out, b.speed);
+    }
+  }
+  if(mask & NET_OBSTACLES) {
+    putCells(out, s.obstacles);
+    for(int c = 0; c < 100; c++) if(s.obstacles.test(c / 10, c % 10)) putVarint(out, s.obstaclePhase[c]);
+  }
+  if(mask & NET_COINS) {
+    // Between placements coins only go, so the ones picked up are sent
+    bool removals = base.tick >= 0 && !andNot(s.coins, base.coins).any();
+    putVarint(out, removals);
+    putCells(out, removals ? andNot(base.coins, s.coins) : s.coins);
+  }
+  if(mask & NET_GHOSTS) {
+    putVarint(out, s.ghosts);
+    for(int k = 0; k < s.ghosts; k++) {
+      const NetGhost &g = s.ghost[k];
+      const NetGhost *h = base.tick >= 0 ? findGhost(base, g.id) : NULL;
+      out.push_back(g.id);
+      putSigned(out, g.x - (h ? h->x : 0));
+      putSigned(out, g.y - (h ? h->y : 0));
+      putSigned(out, g.z - (h ? h->z : 0));
+    }
+  }
+}
+
+/* Inverse of putDelta(), 's' starts as a copy of 'base' */
+bool getDelta(const vector<unsigned char> &in, size_t &pos, const NetState &base, NetState &s) {
+  s = base;
+  unsigned long long mask, u;
+  long v, w, x;
+  if(!getVarint(in, pos, mask)) return false;
+  if(mask & NET_FLAGS) {
+    if(!getVarint(in, pos, u)) return false;
+    s.flags = u;
+  }
+  if(mask & NET_POSITION) {
+    if(!getSigned(in, pos, v) || !getSigned(in, pos, w) || !getSigned(in, pos, x)) return false;
+    s.x = base.x + v, s.y = base.y + w, s.z = base.z + x;
+  }
+  if(mask & NET_JUMP) {
+    if(!getVarint(in, pos, u) || !getSigned(in, pos, v) || !getSigned(in, pos, w)) return false;
+    s.direction = u, s.prevX = v, s.prevZ = w;
+  }
+  if(mask & NET_SCORE) {
+    int *fields[5] = { &s.level, &s.lives, &s.points, &s.speed, &s.house };
+    for(int k = 0; k < 5; k++) {
+      if(!getVarint(in, pos, u)) return false;
+      *fields[k] = u;
+    }
+  }
+  if(mask & NET_CLOCK) {
+    if(!getSigned(in, pos, v) || !getSigned(in, pos, w)) return false;
+    s.clock = base.clock + v, s.respawn = base.respawn + w;
+  }
+  if(mask & NET_ANIMATE) {
+    if(!getSigned(in, pos, v) || !getSigned(in, pos, w)) return false;
+    s.animateX = base.animateX + v, s.animateY = base.animateY + w;
+  }
+  if(mask & NET_BOARD) {
+    if(!getVarint(in, pos, u)) return false;
+    s.board = u;
+    if(!getBoard(in, pos, s.isPresent) || !getBoard(in, pos, s.isMoving) || !getVarint(in, pos, u) || u > 100) return false;
+    s.blocks = u;
+    for(int k = 0; k < s.blocks; k++) {
+      NetBlock &b = s.block[k];
+      if(pos >= in.size() || in[pos] >= 100) return false;
+      b.cell = in[pos++];
+      unsigned long long phase, speed;
+      if(!getSigned(in, pos, v) || !getSigned(in, pos, w) || !getVarint(in, pos, phase) || !getVarint(in, pos, speed)) return false;
+      b.baseY = v, b.amplitude = w, b.phase = phase, b.speed = speed;
+    }
+  }
+  if(mask & NET_OBSTACLES) {
+    if(!getCells(in, pos, s.obstacles)) return false;
+    for(int c = 0; c < 100; c++) {
+      if(!s.obstacles.test(c / 10, c % 10)) continue;
+      if(!getVarint(in, pos, u) || u > 0xffff) return false;
+      s.obstaclePhase[c] = u;
+    }
+  }
+  if(mask & NET_COINS) {
+    Bitboard cells;
+    if(!getVarint(in, pos, u) || !getCells(in, pos, cells)) return false;
+    s.coins = u ? andNot(base.coins, cells) : cells;
+  }
+  if(mask & NET_GHOSTS) {
+    if(!getVarint(in, pos, u) || u > netMaxPlayers) return false;
+    s.ghosts = u;
+    for(int k = 0; k < s.ghosts; k++) {
+      NetGhost &g = s.ghost[k];
+      if(pos >= in.size()) return false;
+      g.id = in[pos++];
+      const NetGhost *h = findGhost(base, g.id);
+      if(!getSigned(in, pos, v) || !getSigned(in, pos, w) || !getSigned(in, pos, x)) return false;
+      g.x = (h ? h->x : 0) + v, g.y = (h ? h->y : 0) + w, g.z = (h ? h->z : 0) + x;
+    }
+  }
+  return true;
+}
+
+/* 16 bit FNV-1a of the full encoding, catches a delta decoded wrong */
+unsigned netChecksum(const NetState &s) {
+  vector<unsigned char> full;
+  putDelta(full, s, NetState());
+  unsigned h = 2166136261u;
+  for(int k = 0; k < full.size(); k++) h = (h ^ full[k]) * 16777619u;
+  return (h ^ (h >> 16)) & 0xffff;
+}
+
+/* Client side game from a snapshot. Everything drawn is replaced, what the
+   snapshot lacks (random streams) is left alone. Of the timers only the
+   respawn is known, for the bot */
+void applyState(Game &g, const NetState &s) {
+  g.tick = s.tick;
+  g.time = s.tick * tickLength;
+  for(int k = 0; k < netFlagCount; k++) g.*netFlags[k] = s.flags >> k & 1;
+  g.playerDirection = s.direction, g.prevPlayerX = s.prevX, g.prevPlayerZ = s.prevZ;
+  g.level = s.level, g.lives = s.lives, g.points = s.points, g.speed = s.speed, g.playerHouse = s.house;
+  g.currentTime = s.clock * tickLength;
+  g.timers = startTimers(s.tick);
+  if(s.respawn >= 0) scheduleTimer(g.timers, TIMER_RESPAWN, s.respawn);
+  g.animateX = s.animateX / netUnit, g.animateY = s.animateY / netUnit;
+  g.boardsDrawn = s.board;
+  g.isPresent = s.isPresent, g.isMoving = s.isMoving;
+
+  Entities &e = g.entities;
+  e.count = 0;
+  float x = s.x / netUnit, z = s.z / netUnit;
+  addEntity(e, ENTITY_PLAYER, cellOf(x, shiftX), cellOf(z, shiftZ), s.y / netUnit);
+  e.x[playerEntity] = x, e.z[playerEntity] = z;
+  for(int k = 0; k < s.blocks; k++) {
+    const NetBlock &b = s.block[k];
+    int n = addEntity(e, ENTITY_BLOCK, b.cell / 10, b.cell % 10, -1);
+    e.baseY[n] = b.baseY / 1024.0f, e.amplitude[n] = b.amplitude / 1024.0f;
+    e.phase[n] = b.phase / 65536.0f, e.speed[n] = b.speed / 65536.0f;
+  }
+  for(int c = 0; c < 100; c++) {
+    if(s.obstacles.test(c / 10, c % 10)) {
+      int n = addEntity(e, ENTITY_OBSTACLE, c / 10, c % 10, 4);
+      setWave(e, n, 4, 5, 0.3, 0);
+      e.phase[n] = s.obstaclePhase[c] / 65536.0f;
+    }
+    if(s.coins.test(c / 10, c % 10)) addEntity(e, ENTITY_COIN, c / 10, c % 10, 4.2);
+  }
+  moveEntities(e, g.time);
+}
+
+/* Other players between snapshots 'from' and 'to', entities of kind
+   ENTITY_PLAYER after the player's own */
+void placeGhosts(Game &g, const NetState &from, const NetState &to, float alpha) {
+  Entities &e = g.entities;
+  removeKind(e, ENTITY_PLAYER);
+  for(int k = 0; k < to.ghosts; k++) {
+    const NetGhost &b = to.ghost[k];
+    const NetGhost *a = findGhost(from, b.id);
+    if(!a) a = &b;
+    float x = (a->x + (b.x - a->x) * alpha) / netUnit, z = (a->z + (b.z - a->z) * alpha) / netUnit;
+    int n = addEntity(e, ENTITY_PLAYER, cellOf(x, shiftX), cellOf(z, shiftZ), (a->y + (b.y - a->y) * alpha) / netUnit);
+    if(n < 0) return;
+    e.x[n] = x, e.z[n] = z;
+  }
+}
+
+/* One tick of the client's own player from the keys held: the distances of
+   drawMove() and drawJump() without the collisions, the host has those */
+void predictPlayer(Game &g) {
+  Entities &e = g.entities;
+  const int p = playerEntity;
+  g.tick++;
+  g.time += tickLength;
+  moveEntities(e, g.time);
+  if(!g.playerWin) g.currentTime += tickLength;
+  if(g.onMenu) return;
+  if(g.playerWin || g.playerLose || g.playerFall || g.playerAnimate) return;
+
+  int d = g.playerJumpUp ? 1 : g.playerJumpDown ? 2 : g.playerJumpRight ? 3 : g.playerJumpLeft ? 4 : 0;
+  if(d) {
+    float &pos = d <= 2 ? e.x[p] : e.z[p];
+    float start = d <= 2 ? 2*g.prevPlayerX + shiftX : 2*g.prevPlayerZ + shiftZ;
+    float sign = d == 1 || d == 3 ? 1 : -1;
+    float step = 0.05*tickScale;
+    e.y[p] += (pos - start) * sign >= 2 ? -step : step;
+    pos += sign * step;
+    if(e.y[p] < 4.2) e.y[p] = 4.2;
+    if((pos - start) * sign >= 4) {
+      pos = start + 4*sign;
+      e.y[p] = 4.2;
+      jumpFlag(g, d) = false;
+    }
+  }
+  else {
+    double step = 0.1*g.speed*tickScale;
+    if(g.playerMoveUp) e.x[p] += step;
+    else if(g.playerMoveDown) e.x[p] -= step;
+    else if(g.playerMoveRight) e.z[p] += step;
+    else if(g.playerMoveLeft) e.z[p] -= step;
+  }
+  updateCell(g);
+}
+
+/* Sockets */
+
+/* Non-blocking UDP socket on 'port', 0 for any */
+int openSocket(int port) {
+  int s = socket(AF_INET, SOCK_DGRAM, 0);
+  if(s < 0) return -1;
+  sockaddr_in a = sockaddr_in();
+  a.sin_family = AF_INET;
+  a.sin_addr.s_addr = htonl(INADDR_ANY);
+  a.sin_port = htons(port);
+  if(bind(s, (sockaddr*)&a, sizeof(a)) < 0) {
+    close(s);
+    return -1;
+  }
+  fcntl(s, F_SETFL, fcntl(s, F_GETFL) | O_NONBLOCK);
+  return s;
+}
+
+/* "host:port" */
+bool resolveAddress(const char *text, sockaddr_in &a) {
+  string s = text;
+  size_t colon = s.rfind(':');
+  if(colon == string::npos) return false;
+  addrinfo hints = addrinfo(), *found = NULL;
+  hints.ai_family = AF_INET;
+  hints.ai_socktype = SOCK_DGRAM;
+  if(getaddrinfo(s.substr(0, colon).c_str(), s.substr(colon + 1).c_str(), &hints, &found) || !found) return false;
+  a = *(sockaddr_in*)found->ai_addr;
+  freeaddrinfo(found);
+  return true;
+}
+
+bool sameAddress(const sockaddr_in &a, const sockaddr_in &b) {
+  return a.sin_addr.s_addr == b.sin_addr.s_addr && a.sin_port == b.sin_port;
+}
+
+/* Size of the packet read into 'in', 0 when none is waiting */
+int receivePacket(int s, vector<unsigned char> &in, sockaddr_in &from) {
+  in.resize(netMaxPacket);
+  socklen_t length = sizeof(from);
+  int n = recvfrom(s, &in[0], in.size(), 0, (sockaddr*)&from, &length);
+  in.resize(n > 0 ? n : 0);
+  return n > 0 ? n : 0;
+}
+
+void sendPacket(int s, const vector<unsigned char> &out, const sockaddr_in &to) {
+  sendto(s, &out[0], out.size(), 0, (const sockaddr*)&to, sizeof(to));
+}
+
+/* Host */
+
+struct NetPeer {
+  bool active = false;
+  sockaddr_in address;
+  int id;
+  Game game;
+  unsigned lastInput = 0;      // sequence number of the last event applied
+  long acked = -1;             // newest snapshot the client has
+  NetState sent[netHistory];   // by tick / netSnapshotTicks % netHistory
+  double lastHeard;
+  long bytesIn = 0, bytesOut = 0;
+};
+
+void welcomePeer(int s, const NetPeer &peer) {
+  vector<unsigned char> out;
+  out.push_back(NET_WELCOME);
+  out.push_back(netVersion);
+  out.push_back(peer.id);
+  putVarint(out, gameSeed);
+  putVarint(out, tickRate);
+  sendPacket(s, out, peer.address);
+}
+
+void receiveInput(NetPeer &peer, const vector<unsigned char> &in, size_t pos) {
+  unsigned long long acked, first, count;
+  if(!getVarint(in, pos, acked) || !getVarint(in, pos, first) || !getVarint(in, pos, count)) return;
+  if((long)acked - 1 > peer.acked) peer.acked = acked - 1;
+  for(unsigned long long k = 0; k < count && pos < in.size(); k++) {
+    unsigned char b = in[pos++];
+    if(first + k <= peer.lastInput) continue; // resent, already applied
+    InputEvent e;
+    e.time = peer.game.time;
+    e.key = b & 0x0f;
+    e.press = b & 0x10;
+    e.relative = b & 0x20;
+    if(e.key < NUM_INPUT_KEYS) applyInput(peer.game, e);
+    peer.lastInput = first + k;
+  }
+}
+
+void sendSnapshot(int s, NetPeer &peer, const NetPeer *peers) {
+  Game &g = peer.game;
+  NetState &state = peer.sent[g.tick / netSnapshotTicks % netHistory];
+  captureState(g, state);
+  for(int k = 0; k < netMaxPlayers; k++) {
+    if(!peers[k].active || &peers[k] == &peer) continue;
+    const Entities &e = peers[k].game.entities;
+    NetGhost &ghost = state.ghost[state.ghosts++];
+    ghost.id = peers[k].id;
+    ghost.x = quantize(e.x[playerEntity], netUnit), ghost.y = quantize(e.y[playerEntity], netUnit), ghost.z = quantize(e.z[playerEntity], netUnit);
+  }
+
+  static const NetState none = NetState();
+  const NetState *base = &none;
+  if(peer.acked >= 0) {
+    const NetState &old = peer.sent[peer.acked / netSnapshotTicks % netHistory];
+    if(old.tick == peer.acked) base = &old;
+  }
+  vector<unsigned char> out;
+  out.push_back(NET_SNAPSHOT);
+  putVarint(out, state.tick);
+  putVarint(out, base->tick + 1);
+  putVarint(out, peer.lastInput);
+  unsigned sum = netChecksum(state);
+  out.push_back(sum & 0xff);
+  out.push_back(sum >> 8);
+  putDelta(out, state, *base);
+  sendPacket(s, out, peer.address);
+  peer.bytesOut += out.size();
+}
+
+/* --host: the authoritative games for up to netMaxPlayers clients, stepped
+   at tickRate for 'seconds', 0 to run until killed */
+int runHost(int port, double seconds) {
+  int s = openSocket(port);
+  if(s < 0) {
+    printf("Could not open UDP port %d\n", port);
+    return 1;
+  }
+  reportLevels = false;
+  vector<NetPeer> peers(netMaxPlayers);
+  printf("Hosting on UDP port %d, seed %u\n", port, gameSeed);
+
+  Ticker ticker = startTicker(tickLength);
+  double start = inputClock(), reported = start;
+  vector<unsigned char> in;
+  sockaddr_in from;
+  while(seconds <= 0 || inputClock() - start < seconds) {
+    double now = inputClock();
+    while(receivePacket(s, in, from)) {
+      NetPeer *peer = NULL;
+      for(int k = 0; k < netMaxPlayers; k++) if(peers[k].active && sameAddress(peers[k].address, from)) peer = &peers[k];
+      if(in[0] == NET_HELLO && in.size() >= 2 && in[1] == netVersion) {
+        for(int k = 0; k < netMaxPlayers && !peer; k++) {
+          if(peers[k].active) continue;
+          peer = &peers[k];
+          *peer = NetPeer();
+          peer->active = true;
+          peer->address = from;
+          peer->id = k + 1;
+          seedGame(peer->game, gameSeed);
+          printf("Player %d joined from %s:%d\n", peer->id, inet_ntoa(from.sin_addr), ntohs(from.sin_port));
+        }
+        if(peer) welcomePeer(s, *peer); // again if the first one was lost
+      }
+      if(!peer) continue;
+      peer->lastHeard = now;
+      peer->bytesIn += in.size();
+      if(in[0] == NET_INPUT) receiveInput(*peer, in, 1);
+      else if(in[0] == NET_BYE) peer->lastHeard = -netTimeout;
+    }
+
+    for(int k = 0; k < netMaxPlayers; k++) {
+      NetPeer &peer = peers[k];
+      if(!peer.active) continue;
+      if(now - peer.lastHeard > netTimeout) {
+        printf("Player %d left at level %d with %d points\n", peer.id, peer.game.level, peer.game.points);
+        peer.active = false;
+        continue;
+      }
+      stepGame(peer.game);
+    }
+    for(int k = 0; k < netMaxPlayers; k++)
+      if(peers[k].active && peers[k].game.tick % netSnapshotTicks == 0) sendSnapshot(s, peers[k], &peers[0]);
+
+    if(now - reported >= netReport) {
+      for(int k = 0; k < netMaxPlayers; k++) {
+        NetPeer &peer = peers[k];
+        if(!peer.active) continue;
+        printf("Player %d: level %d, %d points, %.0f B/s out, %.0f B/s in\n", peer.id, peer.game.level, peer.game.points,
+               peer.bytesOut / (now - reported), peer.bytesIn / (now - reported));
+        peer.bytesOut = peer.bytesIn = 0;
+      }
+      fflush(stdout);
+      reported = now;
+    }
+
+    waitTick(ticker);
+  }
+  vector<unsigned char> bye(1, NET_BYE);
+  for(int k = 0; k < netMaxPlayers; k++) if(peers[k].active) sendPacket(s, bye, peers[k].address);
+  close(s);
+  return 0;
+}
+
+/* Client */
+
+struct NetClient {
+  int socket = -1;
+  sockaddr_in host;
+  int id = 0;
+  NetState states[netHistory];     // received, by tick / netSnapshotTicks % netHistory
+  long latest = -1, previous = -1; // ticks of the two newest
+  double latestAt = 0;             // inputClock() when the newest arrived
+  vector<InputEvent> unsent;       // events not yet acknowledged, sequence numbers from firstUnacked
+  vector<double> sentAt;
+  unsigned firstUnacked = 1;
+  double roundTrip = 0;
+  double lastHeard = 0;
+  bool hostGone = false;
+  long bytesIn = 0, bytesOut = 0, snapshots = 0, checksumErrors = 0;
+};
+
+NetClient client;
+
+/* Handshake with the host at 'address', true once welcomed */
+bool joinHost(const char *address) {
+  if(!resolveAddress(address, client.host)) {
+    printf("Cannot resolve %s\n", address);
+    return false;
+  }
+  client.socket = openSocket(0);
+  if(client.socket < 0) return false;
+  vector<unsigned char> hello, in;
+  hello.push_back(NET_HELLO);
+  hello.push_back(netVersion);
+  sockaddr_in from;
+  for(double start = inputClock(); inputClock() - start < netTimeout;) {
+    sendPacket(client.socket, hello, client.host);
+    std::this_thread::sleep_for(std::chrono::milliseconds(200));
+    while(receivePacket(client.socket, in, from)) {
+      unsigned long long seed, rate;
+      size_t pos = 3;
+      if(!sameAddress(from, client.host) || in.size() < 4 || in[0] != NET_WELCOME || in[1] != netVersion || !getVarint(in, pos, seed) || !getVarint(in, pos, rate) || rate == 0) continue;
+      client.id = in[2];
+      gameSeed = seed;
+      setTickRate(rate);
+      client.lastHeard = inputClock();
+      printf("Joined %s as player %d, seed %u, %d Hz\n", address, client.id, gameSeed, tickRate);
+      return true;
+    }
+  }
+  printf("No answer from %s\n", address);
+  return false;
+}
+
+/* onInputApplied while joined: every event also goes to the host */
+void queueInput(const Game &, const InputEvent &e) {
+  client.unsent.push_back(e);
+  client.sentAt.push_back(inputClock());
+}
+
+/* Keys the client predicts with, menu choices wait for the host */
+bool predictedKey(int key) {
+  return key < INPUT_HOUSE1;
+}
+
+void sendInput() {
+  vector<unsigned char> out;
+  out.push_back(NET_INPUT);
+  putVarint(out, client.latest + 1);
+  putVarint(out, client.firstUnacked);
+  putVarint(out, client.unsent.size());
+  for(int k = 0; k < client.unsent.size(); k++) {
+    const InputEvent &e = client.unsent[k];
+    out.push_back(e.key | (e.press ? 0x10 : 0) | (e.relative ? 0x20 : 0));
+  }
+  sendPacket(client.socket, out, client.host);
+  client.bytesOut += out.size();
+}
+
+/* Reads whatever arrived, true when there is a newer snapshot */
+bool receiveSnapshots() {
+  vector<unsigned char> in;
+  sockaddr_in from;
+  bool fresh = false;
+  while(receivePacket(client.socket, in, from)) {
+    if(!sameAddress(from, client.host)) continue;
+    client.lastHeard = inputClock();
+    client.bytesIn += in.size();
+    if(in[0] == NET_BYE) client.hostGone = true;
+    if(in[0] != NET_SNAPSHOT) continue;
+    size_t pos = 1;
+    unsigned long long tick, baseTick, lastInput;
+    if(!getVarint(in, pos, tick) || !getVarint(in, pos, baseTick) || !getVarint(in, pos, lastInput) || pos + 2 > in.size()) continue;
+    if((long)tick <= client.latest) continue; // late or repeated
+    unsigned sum = in[pos] | in[pos + 1] << 8;
+    pos += 2;
+    static const NetState none = NetState();
+    const NetState *base = &none;
+    if(baseTick) {
+      base = &client.states[(baseTick - 1) / netSnapshotTicks % netHistory];
+      if(base->tick != (long)baseTick - 1) continue; // no longer kept
+    }
+    NetState s;
+    if(!getDelta(in, pos, *base, s)) continue;
+    s.tick = tick;
+    if(netChecksum(s) != sum) {
+      client.checksumErrors++;
+      continue;
+    }
+    client.states[tick / netSnapshotTicks % netHistory] = s;
+    client.previous = client.latest;
+    client.latest = tick;
+    client.latestAt = inputClock();
+    client.snapshots++;
+    fresh = true;
+
+    // Events the host has applied need no resending
+    int done = min((long)client.unsent.size(), (long)lastInput - (long)client.firstUnacked + 1);
+    if(done > 0) {
+      client.roundTrip = client.latestAt - client.sentAt[done - 1];
+      client.unsent.erase(client.unsent.begin(), client.unsent.begin() + done);
+      client.sentAt.erase(client.sentAt.begin(), client.sentAt.begin() + done);
+      client.firstUnacked += done;
+    }
+  }
+  return fresh;
+}
+
+/* One client tick on game 'g': the host's newest state if there is one,
+   with the keys not yet applied there on top, predicted ahead a round trip,
+   or else the prediction moved on a tick. Keyboard events and the bot go to
+   the host through onInputApplied */
+void clientTick(Game &g, bool keyboard) {
+  if(receiveSnapshots()) {
+    applyState(g, client.states[client.latest / netSnapshotTicks % netHistory]);
+    for(int k = 0; k < client.unsent.size(); k++)
+      if(predictedKey(client.unsent[k].key)) applyInput(g, client.unsent[k]);
+    int ahead = min((int)(client.roundTrip / tickLength + 0.5), 30);
+    for(int k = 0; k < ahead; k++) predictPlayer(g);
+  }
+  else predictPlayer(g);
+
+  if(keyboard) {
+    InputEvent *e;
+    while((e = inputQueue.front())) {
+      if(predictedKey(e->key)) applyInput(g, *e);
+      queueInput(g, *e);
+      inputQueue.pop();
+    }
+  }
+  if(botPlaying && !g.onMenu) botTick(liveBot, g);
+  else if(botPlaying && client.unsent.empty()) queueInput(g, InputEvent{ g.time, (unsigned char)(INPUT_HOUSE1 + liveBot.house - 1), false, false });
+
+  if(!client.unsent.empty() || g.tick % netSnapshotTicks == 0) sendInput();
+
+  if(client.previous >= 0) {
+    const NetState &from = client.states[client.previous / netSnapshotTicks % netHistory];
+    const NetState &to = client.states[client.latest / netSnapshotTicks % netHistory];
+    float alpha = min(1.0, (inputClock() - client.latestAt) / (netSnapshotTicks * tickLength));
+    placeGhosts(g, from, to, alpha);
+  }
+}
+
+void printTraffic(double seconds) {
+  printf("%.0f B/s in, %.0f B/s out, %.1f snapshots/s of %.1f bytes, round trip %.1f ms, %ld checksum errors\n",
+         client.bytesIn / seconds, client.bytesOut / seconds, client.snapshots / seconds,
+         (double)client.bytesIn / max(client.snapshots, 1L), client.roundTrip * 1000, client.checksumErrors);
+  fflush(stdout);
+}
+
+/* In place of simulationLoop() while joined */
+void clientLoop() {
+  Ticker ticker = startTicker(tickLength);
+  double reported = inputClock();
+  onInputApplied = queueInput;
+  while(simRunning.load(std::memory_order_relaxed)) {
+    clientTick(game, true);
+    publishSnapshot(game);
+    if(inputClock() - reported >= netReport) {
+      printTraffic(inputClock() - reported);
+      client.bytesIn = client.bytesOut = client.snapshots = 0;
+      reported = inputClock();
+    }
+    waitTick(ticker);
+  }
+  vector<unsigned char> bye(1, NET_BYE);
+  sendPacket(client.socket, bye, client.host);
+}
+
+/* --join with --headless: no window, the bot plays if --bot is given. Ends
+   when the host does, fails if a snapshot was decoded wrong */
+int runHeadlessClient() {
+  reportLevels = false;
+  onInputApplied = queueInput;
+  Ticker ticker = startTicker(tickLength);
+  double start = inputClock();
+  while(!client.hostGone && inputClock() - client.lastHeard < netTimeout) {
+    clientTick(game, false);
+    waitTick(ticker);
+  }
+  printTraffic(inputClock() - start);
+  printf("Host gone, level %d with %d points\n", game.level, game.points);
+  return client.checksumErrors ? 1 : 0;
+}
+
+#endif
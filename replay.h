@@ -0,0 +1,159 @@
+#ifndef REPLAY_H
+#define REPLAY_H
+
+#include "game.h"
+#include "input.h"
+
+/* A session is fully determined by the game seed and the input events
+   with the tick each one was applied at, so that is all a recording holds.
+   Layout: "GOTR", a version byte, varint seed, varint tick rate, then for every event a
+   varint tick delta and one byte: key | 0x10 if pressed | 0x20 if relative.
+   A 0xff byte in place of an event ends the list and is followed by varints
+   of the final tick, points, level and lives, which a replay must reach */
+
+const unsigned char replayVersion = 8; // 1 was seeded through srand(), 2 drew boards from one stream, 3 had a shared block counter, 4 bobbed blocks in lockstep, 5 polled a frame counter for respawns, 6 polled the end of a blink, 7 always ran at 60 Hz
+const unsigned char replayEnd = 0xff;
+
+struct Replay {
+  unsigned seed;
+  int tickRate;               // ticks only line up at the rate they were recorded at
+  vector<long> ticks;         // tick each event was applied at
+  vector<InputEvent> events;
+  long finalTick;
+  int points, level, lives;
+};
+
+unsigned gameSeed = 1;        // --seed, see seedGame()
+
+const char *recordPath = NULL; // --record
+vector<unsigned char> recordBuffer;
+long lastRecordedTick = 0;
+
+Replay replay;
+bool replaying = false;        // --replay, events come from 'replay' instead of the keyboard
+double replaySpeed = 1;        // --replay-speed, 0 runs as fast as possible
+size_t replayNext = 0;
+
+/* LEB128, 7 bits per byte */
+void putVarint(vector<unsigned char> &out, unsigned long long v) {
+  while(v >= 0x80) {
+    out.push_back((unsigned char)(v | 0x80));
+    v >>= 7;
+  }
+  out.push_back((unsigned char)v);
+}
+
+bool getVarint(const vector<unsigned char> &in, size_t &pos, unsigned long long &v) {
+  v = 0;
+  for(int shift = 0; pos < in.size() && shift < 64; shift += 7) {
+    unsigned char b = in[pos++];
+    v |= (unsigned long long)(b & 0x7f) << shift;
+    if(!(b & 0x80)) return true;
+  }
+  return false;
+}
+
+void startRecording(const char *path, unsigned seed) {
+  recordPath = path;
+  recordBuffer.clear();
+  for(int i = 0; i < 4; i++) recordBuffer.push_back("GOTR"[i]);
+  recordBuffer.push_back(replayVersion);
+  putVarint(recordBuffer, seed);
+  putVarint(recordBuffer, tickRate);
+  lastRecordedTick = 0;
+}
+
+/* Called by drainInput() on the simulation thread */
+void recordInput(const Game &g, const InputEvent &e) {
+  putVarint(recordBuffer, g.tick - lastRecordedTick);
+  recordBuffer.push_back(e.key | (e.press ? 0x10 : 0) | (e.relative ? 0x20 : 0));
+  lastRecordedTick = g.tick;
+}
+
+void finishRecording(const Game &g) {
+  if(!recordPath) return;
+  putVarint(recordBuffer, g.tick - lastRecordedTick);
+  recordBuffer.push_back(replayEnd);
+  putVarint(recordBuffer, g.tick);
+  putVarint(recordBuffer, g.points);
+  putVarint(recordBuffer, g.level);
+  putVarint(recordBuffer, g.lives);
+
+  std::ofstream out(recordPath, std::ios::out | std::ios::binary | std::ios::trunc);
+  out.write((const char*)&recordBuffer[0], recordBuffer.size());
+  if(out) cout << "Recorded " << g.tick << " ticks to " << recordPath << " (" << recordBuffer.size() << " bytes)" << endl;
+  else cout << "Could not write recording " << recordPath << endl;
+  recordPath = NULL;
+}
+
+bool loadReplay(const char *path, Replay &r) {
+  std::ifstream in(path, std::ios::in | std::ios::binary);
+  vector<unsigned char> data((std::istreambuf_iterator<char>(in)), std::istreambuf_iterator<char>());
+  if(data.size() < 5 || memcmp(&data[0], "GOTR", 4) || data[4] != replayVersion) {
+    cout << "Not a replay file: " << path << endl;
+    return false;
+  }
+
+  size_t pos = 5;
+  unsigned long long v;
+  if(!getVarint(data, pos, v)) return false;
+  r.seed = v;
+  if(!getVarint(data, pos, v) || v == 0) return false;
+  r.tickRate = v;
+  r.ticks.clear();
+  r.events.clear();
+  long tick = 0;
+  while(getVarint(data, pos, v) && pos < data.size()) {
+    tick += v;
+    unsigned char b = data[pos++];
+    if(b == replayEnd) {
+      unsigned long long finalTick, points, level, lives;
+      if(!getVarint(data, pos, finalTick) || !getVarint(data, pos, points) || !getVarint(data, pos, level) || !getVarint(data, pos, lives)) break;
+      r.finalTick = finalTick;
+      r.points = points;
+      r.level = level;
+      r.lives = lives;
+      return true;
+    }
+    InputEvent e;
+    e.time = 0;
+    e.key = b & 0x0f;
+    e.press = b & 0x10;
+    e.relative = b & 0x20;
+    r.ticks.push_back(tick);
+    r.events.push_back(e);
+  }
+  cout << "Replay is truncated: " << path << endl;
+  return false;
+}
+
+/* Apply the recorded events due at this tick, in place of drainInput() */
+void replayInput(Game &g) {
+  while(replayNext < replay.events.size() && replay.ticks[replayNext] <= g.tick)
+    applyInput(g, replay.events[replayNext++]);
+}
+
+/* Compare with the state the recording ended in */
+bool verifyReplay(const Game &g) {
+  bool ok = g.points == replay.points && g.level == replay.level && g.lives == replay.lives;
+  printf("Replay %s at tick %ld: points %d (recorded %d), level %d (recorded %d), lives %d (recorded %d)\n",
+      ok ? "matches" : "DIVERGED", g.tick, g.points, replay.points, g.level, replay.level, g.lives, replay.lives);
+  return ok;
+}
+
+/* --replay with --headless: no window, runs as fast as the rules allow */
+int runHeadlessReplay() {
+  Game g;
+  seedGame(g, replay.seed);
+  replayNext = 0;
+  double start = inputClock();
+  while(g.tick < replay.finalTick) {
+    replayInput(g);
+    stepGame(g);
+  }
+  double elapsed = inputClock() - start;
+  printf("Simulated %ld ticks (%.1f s of play) in %.3f s\n", g.tick, g.time, elapsed);
+  return verifyReplay(g) ? 0 : 1;
+}
+
+#endif
@@ -0,0 +1,41 @@
+#ifndef RNG_H
+#define RNG_H
+
+#include <stdint.h>
+
+/* PCG32 (O'Neill, pcg-random.org): 64 bits of state, and a stream selector
+   so every subsystem draws from its own independent sequence. Results are
+   the same on every platform, unlike rand() */
+
+struct Rng {
+  uint64_t state;
+  uint64_t inc; // stream, always odd
+};
+
+uint32_t rngNext(Rng &r) {
+  uint64_t old = r.state;
+  r.state = old * 6364136223846793005ULL + r.inc;
+  uint32_t xorshifted = (uint32_t)(((old >> 18u) ^ old) >> 27u);
+  uint32_t rot = (uint32_t)(old >> 59u);
+  return (xorshifted >> rot) | (xorshifted << ((-rot) & 31));
+}
+
+void rngSeed(Rng &r, uint64_t seed, uint64_t stream) {
+  r.state = 0;
+  r.inc = (stream << 1u) | 1u;
+  rngNext(r);
+  r.state += seed;
+  rngNext(r);
+}
+
+/* Uniform in [0, n) without modulo bias */
+int rngBelow(Rng &r, int n) {
+  uint32_t bound = (uint32_t)n;
+  uint32_t threshold = -bound % bound;
+  while(true) {
+    uint32_t x = rngNext(r);
+    if(x >= threshold) return x % bound;
+  }
+}
+
+#endif
@@ -0,0 +1,85 @@
+#ifndef SERVER_H
+#define SERVER_H
+
+#include <thread>
+#include "game.h"
+#include "bot.h"
+#include "threads.h"
+
+/* Headless server for many independent sessions, one per player, each a
+   Game of its own: its own board, entities and random streams seeded from
+   the session number, so a session plays exactly as it would alone and its
+   result can be checked against a replay. Every tick the sessions are
+   stepped in chunks on the work stealing pool, then the server sleeps
+   until the next tick. Bots stand in for the players */
+
+const int serveChunk = 256;       // sessions per pool job
+const double serveReport = 5;     // seconds between reports
+
+struct Session {
+  Game game;
+  Bot bot;
+};
+
+void startSession(Session &s, unsigned seed, int n) {
+  s.game = Game();
+  seedGame(s.game, seed + n);
+  s.bot = Bot();
+  s.bot.house = 1 + n % 9;
+}
+
+void stepSession(Session &s) {
+  botTick(s.bot, s.game);
+  stepGame(s.game);
+}
+
+/* --serve: 'count' sessions at tickRate for 'seconds' of wall time, 0 to
+   run until killed. Reports the ticks stepped per second and how much of
+   every tick the pool was busy, and from that how many sessions a core
+   could keep up with */
+int runServer(unsigned seed, int count, double seconds) {
+  reportLevels = false;
+  vector<Session> sessions(count);
+  for(int n = 0; n < count; n++) startSession(sessions[n], seed, n);
+  ThreadPool pool;
+  startPool(pool, 0);
+  int cores = pool.workers.size();
+  printf("Serving %d sessions at %d Hz on %d threads\n", count, tickRate, cores);
+
+  Ticker ticker = startTicker(tickLength);
+  double start = inputClock(), reported = start, busy = 0, totalBusy = 0;
+  long ticks = 0, late = 0, totalTicks = 0;
+  while(seconds <= 0 || inputClock() - start < seconds) {
+    double tickStart = inputClock();
+    for(int first = 0; first < count; first += serveChunk) {
+      Session *chunk = &sessions[first];
+      int size = min(serveChunk, count - first);
+      submit(pool, [=] {
+        for(int k = 0; k < size; k++) stepSession(chunk[k]);
+      });
+    }
+    waitPool(pool);
+    double now = inputClock();
+    busy += now - tickStart;
+    ticks++;
+
+    if(now - reported >= serveReport) {
+      double load = busy / (now - reported);
+      printf("%.0f session ticks/s, busy %.1f%% of the time, %ld late ticks, room for %.0f sessions per core\n",
+             ticks * (double)count / (now - reported), 100 * load, late, count / max(load, 1e-9) / cores);
+      fflush(stdout);
+      totalBusy += busy, totalTicks += ticks;
+      busy = 0, ticks = 0, late = 0, reported = now;
+    }
+
+    if(!waitTick(ticker)) late++; // over budget, do not try to catch up
+  }
+  stopPool(pool);
+  totalBusy += busy, totalTicks += ticks;
+  double elapsed = inputClock() - start;
+  printf("%ld ticks of %d sessions in %.1f s: %.0f session ticks/s, busy %.1f%%\n",
+         totalTicks, count, elapsed, totalTicks * (double)count / elapsed, 100 * totalBusy / elapsed);
+  return 0;
+}
+
+#endif
@@ -0,0 +1,269 @@
+#ifndef SHADERS_H
+#define SHADERS_H
+
+#include <iterator>
+#include <sys/stat.h>
+#ifdef __linux__
+#include <sys/inotify.h>
+#include <unistd.h>
+#include <fcntl.h>
+#endif
+
+/* Shader programs are compiled together so drivers with
+   GL_ARB_parallel_shader_compile can work on all of them at once, and
+   linked binaries are cached on disk keyed by the sources and the driver */
+
+const char *shaderCacheDir = ".shadercache";
+
+struct ShaderJob {
+  const char *vertexPath;
+  const char *fragmentPath;
+  GLuint vertexShader, fragmentShader;
+  GLuint program;
+  bool fromCache;
+  string cachePath;
+};
+
+ShaderJob shaderJob(const char *vertexPath, const char *fragmentPath) {
+  ShaderJob job;
+  job.vertexPath = vertexPath;
+  job.fragmentPath = fragmentPath;
+  job.vertexShader = job.fragmentShader = 0;
+  job.program = 0;
+  job.fromCache = false;
+  return job;
+}
+
+string readShaderSource(const char *path) {
+  std::string code;
+  std::ifstream stream(path, std::ios::in);
+  if(stream.is_open()) {
+    std::string Line = "";
+    while(getline(stream, Line))
+      code += "\n" + Line;
+    stream.close();
+  }
+  else cout << "Could not open shader " << path << endl;
+  return code;
+}
+
+/* 64 bit FNV-1a */
+unsigned long long hashString(const string &s, unsigned long long h = 14695981039346656037ULL) {
+  for(int i = 0; i < s.size(); i++) {
+    h ^= (unsigned char)s[i];
+    h *= 1099511628211ULL;
+  }
+  return h;
+}
+
+bool programBinarySupported() {
+  if(!(GLAD_GL_VERSION_4_1 || GLAD_GL_ARB_get_program_binary)) return false;
+  GLint formats = 0;
+  glGetIntegerv(GL_NUM_PROGRAM_BINARY_FORMATS, &formats);
+  return formats > 0;
+}
+
+/* Binaries are only valid for the driver that produced them */
+string shaderCacheKey(const string &vertexCode, const string &fragmentCode) {
+  string driver = string((const char*)glGetString(GL_VENDOR)) + "|" + (const char*)glGetString(GL_RENDERER) + "|" + (const char*)glGetString(GL_VERSION);
+  unsigned long long h = hashString(vertexCode);
+  h = hashString("\x01" + fragmentCode, h);
+  h = hashString("\x01" + driver, h);
+  char key[17];
+  snprintf(key, sizeof(key), "%016llx", h);
+  return key;
+}
+
+bool loadProgramBinary(GLuint program, const string &path) {
+  std::ifstream in(path.c_str(), std::ios::in | std::ios::binary);
+  if(!in.is_open()) return false;
+  GLenum format;
+  if(!in.read((char*)&format, sizeof(format))) return false;
+  vector<char> binary((std::istreambuf_iterator<char>(in)), std::istreambuf_iterator<char>());
+  if(binary.empty()) return false;
+  glProgramBinary(program, format, &binary[0], binary.size());
+  GLint linked = GL_FALSE;
+  glGetProgramiv(program, GL_LINK_STATUS, &linked);
+  return linked == GL_TRUE;
+}
+
+void saveProgramBinary(GLuint program, const string &path) {
+  GLint length = 0;
+  glGetProgramiv(program, GL_PROGRAM_BINARY_LENGTH, &length);
+  if(length <= 0) return;
+  vector<char> binary(length);
+  GLenum format;
+  glGetProgramBinary(program, length, NULL, &format, &binary[0]);
+  mkdir(shaderCacheDir, 0755);
+  std::ofstream out(path.c_str(), std::ios::out | std::ios::binary | std::ios::trunc);
+  out.write((const char*)&format, sizeof(format));
+  out.write(&binary[0], length);
+}
+
+/* Print an info log only when there is something in it */
+void printShaderLog(const char *what, GLuint object, bool isProgram) {
+  GLint length = 0;
+  if(isProgram) glGetProgramiv(object, GL_INFO_LOG_LENGTH, &length);
+  else glGetShaderiv(object, GL_INFO_LOG_LENGTH, &length);
+  if(length <= 1) return;
+  vector<char> log(length);
+  if(isProgram) glGetProgramInfoLog(object, length, NULL, &log[0]);
+  else glGetShaderInfoLog(object, length, NULL, &log[0]);
+  cout << what << ":" << endl << &log[0] << endl;
+}
+
+/* Start building 'job' without waiting for the driver */
+void beginProgram(ShaderJob &job) {
+  string vertexCode = readShaderSource(job.vertexPath);
+  string fragmentCode = readShaderSource(job.fragmentPath);
+  job.program = glCreateProgram();
+
+  bool binaries = programBinarySupported();
+  if(binaries) {
+    job.cachePath = string(shaderCacheDir) + "/" + shaderCacheKey(vertexCode, fragmentCode) + ".bin";
+    if(loadProgramBinary(job.program, job.cachePath)) {
+      job.fromCache = true;
+      return;
+    }
+    glProgramParameteri(job.program, GL_PROGRAM_BINARY_RETRIEVABLE_HINT, GL_TRUE);
+  }
+
+  // Compile and link, status is only queried in finishProgram()
+  job.vertexShader = glCreateShader(GL_VERTEX_SHADER);
+  job.fragmentShader = glCreateShader(GL_FRAGMENT_SHADER);
+  char const * VertexSourcePointer = vertexCode.c_str();
+  glShaderSource(job.vertexShader, 1, &VertexSourcePointer , NULL);
+  glCompileShader(job.vertexShader);
+  char const * FragmentSourcePointer = fragmentCode.c_str();
+  glShaderSource(job.fragmentShader, 1, &FragmentSourcePointer , NULL);
+  glCompileShader(job.fragmentShader);
+  glAttachShader(job.program, job.vertexShader);
+  glAttachShader(job.program, job.fragmentShader);
+  glLinkProgram(job.program);
+}
+
+/* Wait for 'job', report errors and cache the binary, returns true if it linked */
+bool finishProgram(ShaderJob &job) {
+  if(job.fromCache) {
+    cout << "Loaded cached program : " << job.vertexPath << " + " << job.fragmentPath << endl;
+    return true;
+  }
+
+  GLint linked = GL_FALSE;
+  glGetProgramiv(job.program, GL_LINK_STATUS, &linked);
+  if(linked != GL_TRUE) {
+    GLint compiled = GL_FALSE;
+    glGetShaderiv(job.vertexShader, GL_COMPILE_STATUS, &compiled);
+    if(compiled != GL_TRUE) printShaderLog(job.vertexPath, job.vertexShader, false);
+    glGetShaderiv(job.fragmentShader, GL_COMPILE_STATUS, &compiled);
+    if(compiled != GL_TRUE) printShaderLog(job.fragmentPath, job.fragmentShader, false);
+    printShaderLog("Linking program", job.program, true);
+  }
+  else cout << "Compiled program : " << job.vertexPath << " + " << job.fragmentPath << endl;
+
+  glDetachShader(job.program, job.vertexShader);
+  glDetachShader(job.program, job.fragmentShader);
+  glDeleteShader(job.vertexShader);
+  glDeleteShader(job.fragmentShader);
+  job.vertexShader = job.fragmentShader = 0;
+
+  if(linked == GL_TRUE && !job.cachePath.empty()) saveProgramBinary(job.program, job.cachePath);
+  return linked == GL_TRUE;
+}
+
+/* True once the driver is done with 'job', never blocks */
+bool programReady(const ShaderJob &job) {
+  if(job.fromCache || !GLAD_GL_ARB_parallel_shader_compile) return true;
+  GLint done = GL_FALSE;
+  glGetProgramiv(job.program, GL_COMPLETION_STATUS_ARB, &done);
+  return done == GL_TRUE;
+}
+
+/* Build several programs, letting the driver compile them concurrently */
+void loadPrograms(ShaderJob *jobs, int n) {
+  if(GLAD_GL_ARB_parallel_shader_compile)
+    glMaxShaderCompilerThreadsARB(0xFFFFFFFF); // as many threads as the driver likes
+  for(int i = 0; i < n; i++) beginProgram(jobs[i]);
+  for(int i = 0; i < n; i++) finishProgram(jobs[i]);
+}
+
+/* Hot reload: the working directory is watched with inotify (editors often
+   replace files rather than write them in place) and a program whose
+   sources change is rebuilt over the next frames. The new program replaces
+   the old one only if it links */
+
+struct WatchedProgram {
+  const char *vertexPath;
+  const char *fragmentPath;
+  GLuint *programID; // swapped to the rebuilt program
+  bool pending;
+  ShaderJob job;
+};
+
+vector<WatchedProgram> watchedPrograms;
+void (*onProgramsReloaded)() = NULL; // fetches uniform locations again
+int shaderWatchFD = -1;
+
+void watchProgram(const char *vertexPath, const char *fragmentPath, GLuint *programID) {
+  WatchedProgram w;
+  w.vertexPath = vertexPath;
+  w.fragmentPath = fragmentPath;
+  w.programID = programID;
+  w.pending = false;
+  watchedPrograms.push_back(w);
+
+#ifdef __linux__
+  if(shaderWatchFD < 0) {
+    shaderWatchFD = inotify_init1(IN_NONBLOCK);
+    if(shaderWatchFD >= 0 && inotify_add_watch(shaderWatchFD, ".", IN_CLOSE_WRITE | IN_MOVED_TO) < 0) {
+      close(shaderWatchFD);
+      shaderWatchFD = -1;
+    }
+  }
+#endif
+}
+
+void reloadProgram(WatchedProgram &w) {
+  if(w.pending) glDeleteProgram(w.job.program); // superseded by a newer edit
+  w.job = shaderJob(w.vertexPath, w.fragmentPath);
+  beginProgram(w.job);
+  w.pending = true;
+}
+
+/* Call once per frame: picks up changed files and swaps in finished programs */
+void updateShaderWatch() {
+#ifdef __linux__
+  if(shaderWatchFD >= 0) {
+    char events[4096] __attribute__ ((aligned(__alignof__(struct inotify_event))));
+    ssize_t len;
+    while((len = read(shaderWatchFD, events, sizeof(events))) > 0) {
+      for(char *p = events; p < events + len; p += sizeof(struct inotify_event) + ((struct inotify_event*)p)->len) {
+        struct inotify_event *e = (struct inotify_event*)p;
+        if(e->len == 0) continue;
+        for(int i = 0; i < watchedPrograms.size(); i++)
+          if(!strcmp(e->name, watchedPrograms[i].vertexPath) || !strcmp(e->name, watchedPrograms[i].fragmentPath))
+            reloadProgram(watchedPrograms[i]);
+      }
+    }
+  }
+#endif
+
+  bool swapped = false;
+  for(int i = 0; i < watchedPrograms.size(); i++) {
+    WatchedProgram &w = watchedPrograms[i];
+    if(!w.pending || !programReady(w.job)) continue;
+    w.pending = false;
+    if(finishProgram(w.job)) {
+      glDeleteProgram(*w.programID);
+      *w.programID = w.job.program;
+      swapped = true;
+    }
+    else {
+      cout << "Keeping the previous program for " << w.vertexPath << " + " << w.fragmentPath << endl;
+      glDeleteProgram(w.job.program);
+    }
+  }
+  if(swapped && onProgramsReloaded) onProgramsReloaded();
+}
+
+#endif
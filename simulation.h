@@ -0,0 +1,122 @@
+#ifndef SIMULATION_H
+#define SIMULATION_H
+
+#include <atomic>
+#include <thread>
+#include <chrono>
+#include "game.h"
+#include "input.h"
+#include "replay.h"
+#include "bot.h"
+
+/* The game runs on its own thread at tickRate. After every tick a copy of
+   the game is published through a triple buffer: the simulation always has
+   a slot to write, the renderer always has a complete one to read, and
+   neither ever waits for the other */
+
+struct SnapshotBuffer {
+  Game slots[3];
+  std::atomic<int> middle; // slot index, plus freshBit when not yet read
+  int back, front;         // owned by the simulation and the renderer
+};
+
+const int freshBit = 4;
+
+SnapshotBuffer snapshots;
+
+Game game;              // owned by the simulation thread
+bool botPlaying = false; // --bot, a Bot presses the keys alongside the keyboard
+Bot liveBot;
+std::thread simThread;
+std::atomic<bool> simRunning(false);
+
+/* The one place game time is paused or scaled: the rules and their timers
+   only see ticks, these change how fast ticks come */
+double timeScale = 1;              // --time-scale, game seconds per real second
+std::atomic<bool> simPaused(false); // 'p'
+
+void (*onMenuLeft)() = NULL; // wakes a renderer that sleeps on the menu
+bool publishedMenu = false;   // the last snapshot published was on the menu
+
+/* Nothing on the menu is drawn from the game, so while it stays there one
+   snapshot is enough */
+void publishSnapshot(const Game &g) {
+  if(g.onMenu && publishedMenu) return;
+  snapshots.slots[snapshots.back] = g; // vectors keep their capacity, no allocation once warm
+  int old = snapshots.middle.exchange(snapshots.back | freshBit, std::memory_order_acq_rel);
+  snapshots.back = old & 3;
+  if(publishedMenu && !g.onMenu && onMenuLeft) onMenuLeft();
+  publishedMenu = g.onMenu;
+}
+
+/* Latest complete game state, valid until the next call */
+const Game &latestSnapshot() {
+  if(snapshots.middle.load(std::memory_order_relaxed) & freshBit) {
+    int old = snapshots.middle.exchange(snapshots.front, std::memory_order_acq_rel);
+    snapshots.front = old & 3;
+  }
+  return snapshots.slots[snapshots.front];
+}
+
+/* Fixed rate loop, catches up with several ticks after a stall. Input is
+   applied to the tick whose start time follows it, also when catching up.
+   Ticks come timeScale times as fast as in real time, a replay runs at
+   replaySpeed instead and hands over to the keyboard when it ends, the bot
+   plays once the replay is over. While paused no tick runs and keys wait
+   for the first one after */
+void simulationLoop() {
+  typedef std::chrono::steady_clock clock;
+  clock::time_point next = clock::now();
+  while(simRunning.load(std::memory_order_relaxed)) {
+    if(simPaused.load(std::memory_order_relaxed)) {
+      std::this_thread::sleep_for(std::chrono::milliseconds(10));
+      next = clock::now();
+      continue;
+    }
+    double scale = replaying ? replaySpeed : timeScale;
+    double seconds = scale > 0 ? tickLength / scale : 0;
+    clock::duration step = std::chrono::duration_cast<clock::duration>(std::chrono::duration<double>(seconds));
+
+    int ticks = 0;
+    while(clock::now() >= next && ticks < 10) {
+      if(replaying) {
+        replayInput(game);
+        discardInput();
+      }
+      else {
+        drainInput(game, std::chrono::duration<double>(next.time_since_epoch()).count());
+        if(botPlaying) botTick(liveBot, game);
+      }
+      stepGame(game);
+      publishSnapshot(game);
+      if(replaying && game.tick >= replay.finalTick) {
+        verifyReplay(game);
+        replaying = false;
+      }
+      next += step;
+      ticks++;
+    }
+    if(ticks == 10) next = clock::now(); // too far behind, drop the backlog
+    std::this_thread::sleep_until(next);
+  }
+}
+
+/* 'loop' is simulationLoop, or clientLoop() when joined to a host */
+void startSimulation(void (*loop)() = simulationLoop) {
+  snapshots.back = 0;
+  snapshots.middle = 1;
+  snapshots.front = 2;
+  publishedMenu = false;
+  for(int i = 0; i < 3; i++) snapshots.slots[i] = game;
+  simRunning = true;
+  simThread = std::thread(loop);
+}
+
+void stopSimulation() {
+  if(!simRunning) return;
+  simRunning = false;
+  simThread.join();
+  finishRecording(game);
+}
+
+#endif
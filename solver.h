@@ -0,0 +1,71 @@
+#ifndef SOLVER_H
+#define SOLVER_H
+
+#include <deque>
+#include "bitboard.h"
+
+/* Path search over the board with the moves the rules allow: a step to a
+   neighbouring cell, or a jump two cells along a row or column over
+   anything. A cell can be stood on when it is present and not moving.
+   Obstacles are left out, they are regenerated every few seconds.
+
+   The search advances a whole BFS frontier with a few shifts and masks of
+   bitboards per move, so it costs a handful of SSE operations per level of
+   depth instead of a visit per cell */
+
+const Bitboard notLastColumn = ~columnsBoard(9, 9), notFirstColumn = ~columnsBoard(0, 0);
+const Bitboard notLastTwoColumns = ~columnsBoard(8, 9), notFirstTwoColumns = ~columnsBoard(0, 1);
+
+/* Every cell one move away from a cell of 'from' */
+Bitboard expandMoves(const Bitboard &from) {
+  return ((from & notLastColumn) << 1) | ((from & notFirstColumn) >> 1) | (from << 10) | (from >> 10)
+    | ((from & notLastTwoColumns) << 2) | ((from & notFirstTwoColumns) >> 2) | (from << 20) | (from >> 20);
+}
+
+/* Cells reachable from (0, 0), and the number of moves to (9, 9) or -1 */
+int solveBoard(const Bitboard &isPresent, const Bitboard &isMoving, Bitboard *reachable = NULL) {
+  Bitboard open = andNot(isPresent, isMoving);
+  Bitboard frontier = emptyBoard;
+  frontier.set(0, 0);
+  Bitboard reached = frontier;
+  int moves = 0;
+  while(!reached.test(9, 9) && frontier.any()) {
+    frontier = andNot(expandMoves(frontier) & open, reached);
+    reached |= frontier;
+    moves++;
+  }
+  if(reachable) *reachable = reached;
+  return reached.test(9, 9) ? moves : -1;
+}
+
+/* Make the board solvable by fixing as few cells as possible: a 0-1 BFS
+   where landing on a cell that cannot be stood on costs one repair, then
+   the cells on the cheapest path are made present and still */
+void repairBoard(Bitboard &isPresent, Bitboard &isMoving) {
+  const int di[8] = { 1, -1, 0, 0, 2, -2, 0, 0 };
+  const int dj[8] = { 0, 0, 1, -1, 0, 0, 2, -2 };
+  int cost[100], from[100];
+  for(int c = 0; c < 100; c++) cost[c] = 1000, from[c] = -1;
+  std::deque<int> queue;
+  cost[0] = 0;
+  queue.push_back(0);
+  while(!queue.empty()) {
+    int c = queue.front();
+    queue.pop_front();
+    for(int k = 0; k < 8; k++) {
+      int i = c / 10 + di[k], j = c % 10 + dj[k];
+      if(i < 0 || i > 9 || j < 0 || j > 9) continue;
+      int w = (isPresent.test(i, j) && !isMoving.test(i, j)) ? 0 : 1;
+      int n = i*10 + j;
+      if(cost[c] + w >= cost[n]) continue;
+      cost[n] = cost[c] + w;
+      from[n] = c;
+      if(w) queue.push_back(n);
+      else queue.push_front(n);
+    }
+  }
+  for(int c = 99; c > 0; c = from[c])
+    isPresent.set(c / 10, c % 10), isMoving.clear(c / 10, c % 10);
+}
+
+#endif
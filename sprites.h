@@ -0,0 +1,270 @@
+#ifndef SPRITES_H
+#define SPRITES_H
+
+#include <cstddef>
+
+#include "animation.h"
+#include "textures.h"
+
+/* Animated sprites: every frame of a clip is a layer of a 2D array texture
+   and AnimatedSprite.vert picks the layer from the 'time' uniform, so the
+   CPU issues the same instanced draw every frame */
+
+enum {
+  ARRAY_HUD,     // timer, stars and lives share one array
+  ARRAY_WATER,
+  ARRAY_SOLDIER,
+  ARRAY_DRAGON,
+  NUM_SPRITE_ARRAYS
+};
+
+struct SpriteArray {
+  const char *name;
+  int width, height; // every layer is resampled to this size
+  bool lazy;         // loaded when first drawn and evicted when unseen
+  int numLayers;
+  GLuint TextureID;  // 0 while not resident
+  int downscale;     // chosen by the texture budget when allocated
+  int layersLoaded;
+  double lastSeen;   // animClock of the last draw
+};
+
+/* The soldier and dragon are only visible from some tower views */
+SpriteArray spriteArrays[NUM_SPRITE_ARRAYS] = {
+  { "hud",     128, 128, false },
+  { "water",   512, 512, false },
+  { "soldier", 512, 256, true },
+  { "dragon",  512, 512, true }
+};
+
+int spriteLayersPerFrame = 4;     // layers a lazy array uploads per frame
+double spriteEvictAfter = 30;     // seconds unseen before a lazy array is freed
+
+/* Where the frames of each clip in animation.h live */
+struct SpriteSet {
+  int array;
+  const char *pathFormat; // printf format taking the file number
+  int firstFile;
+  int firstLayer;         // filled in by createSpriteArrays()
+};
+
+SpriteSet spriteSets[NUM_CLIPS] = {
+  { ARRAY_HUD,     "images/timer/frame_%d_delay-0.jpg", 0, 0 },        // CLIP_TIMER
+  { ARRAY_WATER,   "images/water/frame-%03d.jpg", 1, 0 },              // CLIP_WATER
+  { ARRAY_HUD,     "images/stars/frame_%d_delay-0.jpg", 0, 0 },        // CLIP_STARS
+  { ARRAY_SOLDIER, "images/soldier/o_a71eebd8de89d627-%d.jpg", 0, 0 }, // CLIP_SOLDIER
+  { ARRAY_DRAGON,  "images/dragon/o_b90b52b369699b6e-%d.jpg", 0, 0 },  // CLIP_DRAGON
+  { ARRAY_HUD,     "images/lives/frame-%03d.jpg", 1, 0 }               // CLIP_LIVES
+};
+
+/* Per-instance vertex data, see AnimatedSprite.vert */
+struct SpriteInstance {
+  GLfloat offsetScale[4]; // model space offset, uniform scale of the unit quad
+  GLfloat clip[3];        // first layer, number of frames, fps
+};
+
+struct SpriteBatch {
+  GLuint VertexArrayID;
+  GLuint VertexBuffer;
+  GLuint TextureBuffer;
+  GLuint InstanceBuffer;
+  vector<SpriteInstance> instances;
+};
+
+SpriteBatch spriteBatches[NUM_SPRITE_ARRAYS];
+
+struct SpriteShader {
+  GLuint programID;
+  GLuint MatrixID;
+  GLuint TimeID;
+  GLuint SamplerID;
+} SpriteProgram;
+
+/* Allocate the array texture of 'n' without any image data */
+void beginSpriteArray(int n) {
+  SpriteArray &a = spriteArrays[n];
+  GLenum internalFormat = textureInternalFormat();
+  a.downscale = textureDownscale(internalFormat, a.width, a.height, a.numLayers);
+  int w = a.width / a.downscale, h = a.height / a.downscale;
+
+  glGenTextures(1, &a.TextureID);
+  glBindTexture(GL_TEXTURE_2D_ARRAY, a.TextureID);
+  glTexParameteri(GL_TEXTURE_2D_ARRAY, GL_TEXTURE_WRAP_S, GL_REPEAT);
+  glTexParameteri(GL_TEXTURE_2D_ARRAY, GL_TEXTURE_WRAP_T, GL_REPEAT);
+  glTexParameteri(GL_TEXTURE_2D_ARRAY, GL_TEXTURE_MIN_FILTER, GL_NEAREST_MIPMAP_NEAREST);
+  glTexParameteri(GL_TEXTURE_2D_ARRAY, GL_TEXTURE_MAG_FILTER, GL_NEAREST);
+  glTexImage3D(GL_TEXTURE_2D_ARRAY, 0, internalFormat, w, h, a.numLayers, 0, GL_RGB, GL_UNSIGNED_BYTE, NULL);
+  glBindTexture(GL_TEXTURE_2D_ARRAY, 0);
+  a.layersLoaded = 0;
+  trackTexture(a.TextureID, a.name, w, h, a.numLayers, a.downscale, internalFormat);
+}
+
+/* Upload up to 'maxLayers' more frames of array 'n', returns true once complete */
+bool streamSpriteArray(int n, int maxLayers) {
+  SpriteArray &a = spriteArrays[n];
+  char path[100];
+  int w = a.width / a.downscale, h = a.height / a.downscale;
+  vector<unsigned char> scaled(3 * w * h);
+
+  glBindTexture(GL_TEXTURE_2D_ARRAY, a.TextureID);
+  glPixelStorei(GL_UNPACK_ALIGNMENT, 1);
+  for(int c = 0; c < NUM_CLIPS && maxLayers > 0; c++) {
+    if(spriteSets[c].array != n) continue;
+    for(int f = 0; f < clips[c].numFrames && maxLayers > 0; f++) {
+      int layer = spriteSets[c].firstLayer + f;
+      if(layer < a.layersLoaded) continue;
+      snprintf(path, sizeof(path), spriteSets[c].pathFormat, spriteSets[c].firstFile + f);
+      a.layersLoaded++;
+      maxLayers--;
+      int twidth, theight;
+      unsigned char* image = SOIL_load_image(path, &twidth, &theight, 0, SOIL_LOAD_RGB);
+      if(image == NULL) {
+        cout << "SOIL loading error: '" << path << "' " << SOIL_last_result() << endl;
+        continue;
+      }
+      const unsigned char *pixels = image;
+      if(twidth != w || theight != h) {
+        resampleImage(image, twidth, theight, &scaled[0], w, h);
+        pixels = &scaled[0];
+      }
+      glTexSubImage3D(GL_TEXTURE_2D_ARRAY, 0, 0, 0, layer, w, h, 1, GL_RGB, GL_UNSIGNED_BYTE, pixels);
+      SOIL_free_image_data(image);
+    }
+  }
+  glPixelStorei(GL_UNPACK_ALIGNMENT, 4);
+
+  bool done = a.layersLoaded == a.numLayers;
+  if(done) {
+    glGenerateMipmap(GL_TEXTURE_2D_ARRAY);
+    if(a.lazy) printf("Sprite array %s resident: %.1f MB (total %.1f MB)\n", a.name, textureSetBytes(a.name) / 1048576.0, textureBytesUsed / 1048576.0);
+  }
+  glBindTexture(GL_TEXTURE_2D_ARRAY, 0);
+  return done;
+}
+
+/* Free the texture of array 'n', it is reloaded when drawn again */
+void releaseSpriteArray(int n) {
+  SpriteArray &a = spriteArrays[n];
+  if(a.TextureID == 0) return;
+  untrackTexture(a.TextureID);
+  glDeleteTextures(1, &a.TextureID);
+  a.TextureID = 0;
+  a.layersLoaded = 0;
+  printf("Sprite array %s evicted (total %.1f MB)\n", a.name, textureBytesUsed / 1048576.0);
+}
+
+/* Lay out the clips in their arrays and load the arrays that are always visible */
+void createSpriteArrays() {
+  for(int c = 0; c < NUM_CLIPS; c++) {
+    SpriteArray &a = spriteArrays[spriteSets[c].array];
+    spriteSets[c].firstLayer = a.numLayers;
+    a.numLayers += clips[c].numFrames;
+  }
+
+  for(int n = 0; n < NUM_SPRITE_ARRAYS; n++) {
+    if(spriteArrays[n].lazy) continue;
+    beginSpriteArray(n);
+    streamSpriteArray(n, spriteArrays[n].numLayers);
+  }
+}
+
+/* Load lazy array 'n' whole now, before it is drawn, so it does not stream
+   in on screen a few layers a frame */
+void preloadSpriteArray(int n) {
+  SpriteArray &a = spriteArrays[n];
+  a.lastSeen = animClock;
+  if(a.layersLoaded == a.numLayers) return;
+  if(a.TextureID == 0) beginSpriteArray(n);
+  streamSpriteArray(n, a.numLayers - a.layersLoaded);
+}
+
+/* Free lazy arrays that have not been drawn for a while, call once per frame */
+void evictSpriteArrays() {
+  for(int n = 0; n < NUM_SPRITE_ARRAYS; n++) {
+    SpriteArray &a = spriteArrays[n];
+    if(a.lazy && a.TextureID != 0 && animClock - a.lastSeen > spriteEvictAfter)
+      releaseSpriteArray(n);
+  }
+}
+
+/* Queue one animated sprite of 'clip', centred at 'offset' in model space */
+void addSprite(int clip, glm::vec3 offset, float scale) {
+  SpriteInstance s;
+  s.offsetScale[0] = offset.x;
+  s.offsetScale[1] = offset.y;
+  s.offsetScale[2] = offset.z;
+  s.offsetScale[3] = scale;
+  s.clip[0] = spriteSets[clip].firstLayer;
+  s.clip[1] = clips[clip].numFrames;
+  s.clip[2] = clips[clip].fps;
+  spriteBatches[spriteSets[clip].array].instances.push_back(s);
+}
+
+/* Create the unit quad VAO of every batch and upload its instances */
+void createSpriteBatches() {
+  static const GLfloat vertex_buffer_data [] = {
+    -0.5,-0.5,0, // vertex 1
+    0.5,-0.5,0, // vertex 2
+    0.5, 0.5,0, // vertex 3
+
+    0.5, 0.5,0, // vertex 3
+    -0.5, 0.5,0, // vertex 4
+    -0.5,-0.5,0  // vertex 1
+  };
+
+  for(int n = 0; n < NUM_SPRITE_ARRAYS; n++) {
+    SpriteBatch &b = spriteBatches[n];
+    glGenVertexArrays(1, &b.VertexArrayID);
+    glGenBuffers(1, &b.VertexBuffer);
+    glGenBuffers(1, &b.TextureBuffer);
+    glGenBuffers(1, &b.InstanceBuffer);
+
+    glBindVertexArray(b.VertexArrayID);
+    glBindBuffer(GL_ARRAY_BUFFER, b.VertexBuffer);
+    glBufferData(GL_ARRAY_BUFFER, sizeof(vertex_buffer_data), vertex_buffer_data, GL_STATIC_DRAW);
+    glVertexAttribPointer(0, 3, GL_FLOAT, GL_FALSE, 0, (void*)0);
+    glEnableVertexAttribArray(0);
+
+    glBindBuffer(GL_ARRAY_BUFFER, b.TextureBuffer);
+    glBufferData(GL_ARRAY_BUFFER, 12*sizeof(GLfloat), texture_buffer_data, GL_STATIC_DRAW);
+    glVertexAttribPointer(2, 2, GL_FLOAT, GL_FALSE, 0, (void*)0);
+    glEnableVertexAttribArray(2);
+
+    glBindBuffer(GL_ARRAY_BUFFER, b.InstanceBuffer);
+    glBufferData(GL_ARRAY_BUFFER, b.instances.size()*sizeof(SpriteInstance), b.instances.empty() ? NULL : &b.instances[0], GL_STATIC_DRAW);
+    glVertexAttribPointer(3, 4, GL_FLOAT, GL_FALSE, sizeof(SpriteInstance), (void*)offsetof(SpriteInstance, offsetScale));
+    glVertexAttribPointer(4, 3, GL_FLOAT, GL_FALSE, sizeof(SpriteInstance), (void*)offsetof(SpriteInstance, clip));
+    for(int attrib = 3; attrib <= 4; attrib++) {
+      glEnableVertexAttribArray(attrib);
+      glVertexAttribDivisor(attrib, 1); // advance once per sprite, not per vertex
+    }
+    glBindVertexArray(0);
+  }
+}
+
+/* Draw every sprite of batch 'n' in one call */
+void drawSpriteBatch(int n, const glm::mat4 &MVP) {
+  SpriteBatch &b = spriteBatches[n];
+  if(b.instances.empty()) return;
+
+  // Lazy arrays stream in a few layers per frame and are skipped until complete
+  SpriteArray &a = spriteArrays[n];
+  a.lastSeen = animClock;
+  if(a.layersLoaded < a.numLayers) {
+    if(a.TextureID == 0) beginSpriteArray(n);
+    if(!streamSpriteArray(n, spriteLayersPerFrame)) return;
+  }
+
+  glUseProgram(SpriteProgram.programID);
+  glUniformMatrix4fv(SpriteProgram.MatrixID, 1, GL_FALSE, &MVP[0][0]);
+  glUniform1f(SpriteProgram.TimeID, (float)animClock);
+  glUniform1i(SpriteProgram.SamplerID, 0);
+
+  glPolygonMode(GL_FRONT_AND_BACK, GL_FILL);
+  glBindVertexArray(b.VertexArrayID);
+  glBindTexture(GL_TEXTURE_2D_ARRAY, spriteArrays[n].TextureID);
+  glDrawArraysInstanced(GL_TRIANGLES, 0, 6, b.instances.size());
+  glBindTexture(GL_TEXTURE_2D_ARRAY, 0);
+}
+
+#endif
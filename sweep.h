@@ -0,0 +1,46 @@
+#ifndef SWEEP_H
+#define SWEEP_H
+
+#include <math.h>
+#include "entities.h"
+
+/* Grid traversal (Amanatides and Woo, "A Fast Voxel Traversal Algorithm"):
+   the cells a straight move crosses, in order, found by stepping from one
+   cell boundary to the next. The cost is one step per cell crossed however
+   long the move is, so a tick can move the player any distance without
+   skipping a cell */
+
+/* Cell along one axis under world coordinate 'x', cell i spans
+   [i*2 + shift - 1, i*2 + shift + 1) */
+int cellOf(float x, int shift) {
+  return (int)floorf((x - shift + 1) / 2);
+}
+
+/* Cells entered going from (x0, z0) to (x1, z1), the start cell left out
+   and the end cell last. At most 'maxCells' are stored, returns how many */
+int sweepCells(float x0, float z0, float x1, float z1, int cells[][2], int maxCells) {
+  // In cell units, cell i spans [i, i + 1)
+  float gx0 = (x0 - shiftX + 1) / 2, gz0 = (z0 - shiftZ + 1) / 2;
+  float gx1 = (x1 - shiftX + 1) / 2, gz1 = (z1 - shiftZ + 1) / 2;
+  int i = cellOf(x0, shiftX), j = cellOf(z0, shiftZ);
+  int iEnd = cellOf(x1, shiftX), jEnd = cellOf(z1, shiftZ);
+  int di = gx1 > gx0 ? 1 : -1, dj = gz1 > gz0 ? 1 : -1;
+  float dx = fabsf(gx1 - gx0), dz = fabsf(gz1 - gz0);
+
+  // Fraction of the move at which the next boundary on each axis is crossed
+  float nextX = dx > 0 ? (di > 0 ? i + 1 - gx0 : gx0 - i) / dx : INFINITY;
+  float nextZ = dz > 0 ? (dj > 0 ? j + 1 - gz0 : gz0 - j) / dz : INFINITY;
+  float stepX = dx > 0 ? 1 / dx : INFINITY, stepZ = dz > 0 ? 1 / dz : INFINITY;
+
+  int n = 0;
+  while(n < maxCells && (i != iEnd || j != jEnd)) {
+    // An axis already on its end cell is never stepped, whatever rounding says
+    if(j == jEnd || (i != iEnd && nextX < nextZ)) i += di, nextX += stepX;
+    else j += dj, nextZ += stepZ;
+    cells[n][0] = i, cells[n][1] = j;
+    n++;
+  }
+  return n;
+}
+
+#endif
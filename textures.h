@@ -0,0 +1,128 @@
+#ifndef TEXTURES_H
+#define TEXTURES_H
+
+/* Texture memory accounting: every texture is recorded with the set it
+   belongs to, and uploads that would exceed the budget are downscaled */
+
+struct TextureRecord {
+  GLuint id;
+  const char *set;
+  int width, height, layers; // as uploaded, after downscaling
+  int downscale;             // 1, 2, 4 ... relative to the source images
+  GLenum internalFormat;
+  size_t bytes;              // including the mip chain
+  bool overBudget;           // uploaded past the budget, no smaller than the floor
+};
+
+vector<TextureRecord> textureRecords;
+size_t textureBudget = (size_t)256 << 20; // --texture-budget, in MB on the command line
+bool compressTextures = false;            // --compress-textures
+size_t textureBytesUsed = 0;
+
+/* DXT1 when asked for and supported. RGTC only stores one or two channels,
+   so it does not apply to these RGB images */
+GLenum textureInternalFormat() {
+  if(compressTextures && GLAD_GL_EXT_texture_compression_s3tc) return GL_COMPRESSED_RGB_S3TC_DXT1_EXT;
+  return GL_RGB8;
+}
+
+/* Bytes of a full mip chain of 'layers' images of w x h */
+size_t textureBytes(GLenum internalFormat, int w, int h, int layers) {
+  size_t bytes = 0;
+  while(true) {
+    if(internalFormat == GL_COMPRESSED_RGB_S3TC_DXT1_EXT)
+      bytes += (size_t)8 * ((w + 3) / 4) * ((h + 3) / 4) * layers; // 8 bytes per 4x4 block
+    else
+      bytes += (size_t)3 * w * h * layers;
+    if(w == 1 && h == 1) break;
+    w = max(w / 2, 1);
+    h = max(h / 2, 1);
+  }
+  return bytes;
+}
+
+/* Smallest power of two downscale that keeps the upload within budget.
+   Dropping the top mip levels this way costs detail only when close up.
+   Nothing goes below 16 texels a side, past that the budget is exceeded
+   and trackTexture() says so */
+int textureDownscale(GLenum internalFormat, int w, int h, int layers) {
+  int scale = 1;
+  while(textureBytesUsed + textureBytes(internalFormat, w / scale, h / scale, layers) > textureBudget
+      && w / scale > 16 && h / scale > 16)
+    scale *= 2;
+  return scale;
+}
+
+void trackTexture(GLuint id, const char *set, int w, int h, int layers, int downscale, GLenum internalFormat) {
+  TextureRecord r;
+  r.id = id;
+  r.set = set;
+  r.width = w;
+  r.height = h;
+  r.layers = layers;
+  r.downscale = downscale;
+  r.internalFormat = internalFormat;
+  r.bytes = textureBytes(internalFormat, w, h, layers);
+  r.overBudget = textureBytesUsed + r.bytes > textureBudget;
+  if(r.overBudget)
+    printf("Warning: %s texture of %dx%d over the %.0f MB texture budget\n", set, w, h, textureBudget / 1048576.0);
+  textureRecords.push_back(r);
+  textureBytesUsed += r.bytes;
+}
+
+void untrackTexture(GLuint id) {
+  for(int i = 0; i < textureRecords.size(); i++) {
+    if(textureRecords[i].id != id) continue;
+    textureBytesUsed -= textureRecords[i].bytes;
+    textureRecords.erase(textureRecords.begin() + i);
+    return;
+  }
+}
+
+/* Bytes used by all textures of 'set' */
+size_t textureSetBytes(const char *set) {
+  size_t bytes = 0;
+  for(int i = 0; i < textureRecords.size(); i++)
+    if(!strcmp(textureRecords[i].set, set)) bytes += textureRecords[i].bytes;
+  return bytes;
+}
+
+void printTextureReport() {
+  printf("Texture memory (%s):\n", textureInternalFormat() == GL_RGB8 ? "RGB8" : "DXT1");
+  vector<const char*> sets;
+  for(int i = 0; i < textureRecords.size(); i++) {
+    bool seen = false;
+    for(int j = 0; j < sets.size(); j++) seen = seen || !strcmp(sets[j], textureRecords[i].set);
+    if(!seen) sets.push_back(textureRecords[i].set);
+  }
+  for(int j = 0; j < sets.size(); j++) {
+    int count = 0, downscaled = 0, over = 0;
+    for(int i = 0; i < textureRecords.size(); i++) {
+      if(strcmp(sets[j], textureRecords[i].set)) continue;
+      count++;
+      if(textureRecords[i].downscale > 1) downscaled++;
+      if(textureRecords[i].overBudget) over++;
+    }
+    printf("  %-10s %3d textures %8.1f MB", sets[j], count, textureSetBytes(sets[j]) / 1048576.0);
+    if(downscaled) printf("  (%d downscaled)", downscaled);
+    if(over) printf("  (%d OVER BUDGET)", over);
+    printf("\n");
+  }
+  printf("  %-10s %12s %8.1f MB of %.0f MB budget%s\n", "total", "", textureBytesUsed / 1048576.0, textureBudget / 1048576.0,
+         textureBytesUsed > textureBudget ? ", OVER BUDGET" : "");
+}
+
+/* Nearest neighbour resample of an RGB image */
+void resampleImage(const unsigned char *src, int sw, int sh, unsigned char *dst, int dw, int dh) {
+  for(int y = 0; y < dh; y++) {
+    const unsigned char *row = src + 3 * sw * (y * sh / dh);
+    for(int x = 0; x < dw; x++) {
+      const unsigned char *p = row + 3 * (x * sw / dw);
+      dst[3 * (y*dw + x)] = p[0];
+      dst[3 * (y*dw + x) + 1] = p[1];
+      dst[3 * (y*dw + x) + 2] = p[2];
+    }
+  }
+}
+
+#endif
@@ -0,0 +1,134 @@
+#ifndef THREADS_H
+#define THREADS_H
+
+#include <thread>
+#include <chrono>
+#include <mutex>
+#include <condition_variable>
+#include <atomic>
+#include <functional>
+#include <deque>
+
+/* A fixed set of worker threads with a deque of jobs each. A worker runs
+   its own newest job first and, when it has none, steals the oldest job of
+   another worker, so uneven jobs spread over the cores without every
+   thread fighting over one queue. Jobs submitted by a worker go to its own
+   deque, the others are dealt out in turn */
+
+struct WorkerQueue {
+  std::mutex mutex;
+  std::deque< std::function<void()> > jobs;
+};
+
+struct ThreadPool {
+  vector<std::thread> workers;
+  std::deque<WorkerQueue> queues;   // one per worker, a deque never moves them
+  std::atomic<int> queued{0};       // jobs waiting in the queues
+  std::atomic<unsigned> nextQueue{0};
+  std::mutex mutex;                 // for sleeping, stopping and waitPool()
+  std::condition_variable wake, idle;
+  int unfinished = 0;               // submitted and not yet done
+  bool stopping = false;
+};
+
+thread_local ThreadPool *currentPool = NULL; // the pool the calling thread works for
+thread_local int currentWorker = -1;
+
+/* Own newest job, or another worker's oldest */
+bool takeJob(ThreadPool *pool, int self, std::function<void()> &job) {
+  int n = pool->queues.size();
+  for(int k = 0; k < n; k++) {
+    WorkerQueue &q = pool->queues[(self + k) % n];
+    std::lock_guard<std::mutex> lock(q.mutex);
+    if(q.jobs.empty()) continue;
+    if(k == 0) job = q.jobs.back(), q.jobs.pop_back();
+    else job = q.jobs.front(), q.jobs.pop_front();
+    pool->queued--;
+    return true;
+  }
+  return false;
+}
+
+void poolWorker(ThreadPool *pool, int self) {
+  currentPool = pool, currentWorker = self;
+  while(true) {
+    std::function<void()> job;
+    if(takeJob(pool, self, job)) {
+      job();
+      std::lock_guard<std::mutex> lock(pool->mutex);
+      if(--pool->unfinished == 0) pool->idle.notify_all();
+      continue;
+    }
+    std::unique_lock<std::mutex> lock(pool->mutex);
+    pool->wake.wait(lock, [pool] { return pool->stopping || pool->queued > 0; });
+    if(pool->stopping && pool->queued <= 0) return; // stopping and drained
+  }
+}
+
+/* 'threads' of 0 uses every core */
+void startPool(ThreadPool &pool, int threads) {
+  if(threads <= 0) threads = max(1u, std::thread::hardware_concurrency());
+  pool.stopping = false;
+  pool.queues.resize(threads);
+  for(int i = 0; i < threads; i++) pool.workers.push_back(std::thread(poolWorker, &pool, i));
+}
+
+void submit(ThreadPool &pool, const std::function<void()> &job) {
+  WorkerQueue &q = pool.queues[currentPool == &pool ? currentWorker : pool.nextQueue++ % pool.queues.size()];
+  {
+    // Counted before anyone can take it, so 'unfinished' never dips
+    std::lock_guard<std::mutex> lock(pool.mutex);
+    pool.unfinished++;
+    std::lock_guard<std::mutex> queueLock(q.mutex);
+    q.jobs.push_back(job);
+    pool.queued++;
+  }
+  pool.wake.notify_one();
+}
+
+/* Blocks until every job submitted so far has run, the workers stay */
+void waitPool(ThreadPool &pool) {
+  std::unique_lock<std::mutex> lock(pool.mutex);
+  pool.idle.wait(lock, [&pool] { return pool.unfinished == 0; });
+}
+
+/* Finishes the queued jobs, then joins the workers */
+void stopPool(ThreadPool &pool) {
+  {
+    std::lock_guard<std::mutex> lock(pool.mutex);
+    pool.stopping = true;
+  }
+  pool.wake.notify_all();
+  for(int i = 0; i < pool.workers.size(); i++) pool.workers[i].join();
+  pool.workers.clear();
+  pool.queues.clear();
+}
+
+/* Paces a loop that runs once every 'step' of wall time. A tick that ends
+   late starts the next one at once and the pace goes on from there, there
+   is no catching up */
+struct Ticker {
+  std::chrono::steady_clock::duration step;
+  std::chrono::steady_clock::time_point next;
+};
+
+Ticker startTicker(double seconds) {
+  Ticker t;
+  t.step = std::chrono::duration_cast<std::chrono::steady_clock::duration>(std::chrono::duration<double>(seconds));
+  t.next = std::chrono::steady_clock::now();
+  return t;
+}
+
+/* Sleeps until the next tick is due, false when this one ran over it */
+bool waitTick(Ticker &t) {
+  t.next += t.step;
+  std::chrono::steady_clock::time_point now = std::chrono::steady_clock::now();
+  if(now > t.next) {
+    t.next = now;
+    return false;
+  }
+  std::this_thread::sleep_until(t.next);
+  return true;
+}
+
+#endif
@@ -0,0 +1,111 @@
+#ifndef TIMERS_H
+#define TIMERS_H
+
+/* Hierarchical timer wheel for game events, counted in simulation ticks. A
+   timer is a number the caller gives it, one of each pending at most, and
+   lives in fixed arrays, so a wheel copies with the Game it belongs to.
+
+   Level 0 has a slot per tick of the current block of timerWheelSize
+   ticks, level 1 a slot per block of the current group of blocks, and so
+   on up. A timer is linked into the lowest level whose span holds both now
+   and its tick. When the wheel enters a new block the timers of that
+   block's slot one level up move down, so each is looked at once per level
+   at most, and a tick only visits the timers that fire on it. Scheduling
+   and cancelling are O(1). Timers beyond the top level wait in it and are
+   filed again every time their slot comes round */
+
+const int maxTimers = 8;
+const int timerBits = 6;
+const int timerWheelSize = 1 << timerBits;  // slots per level
+const int timerLevels = 4;                  // 2^24 ticks, 77 hours at 60 Hz
+
+struct TimerWheel {
+  long now;                       // the last tick advanced to
+  long due[maxTimers];            // tick to fire on, -1 when idle
+  short slot[maxTimers];          // level * timerWheelSize + slot
+  signed char next[maxTimers];    // -1 at the end of a list
+  signed char prev[maxTimers];    // -1 at the head of a list
+  signed char head[timerLevels * timerWheelSize]; // first timer per slot, -1 when empty
+};
+
+/* Idle timers, with the wheel at tick 'now' */
+TimerWheel startTimers(long now) {
+  TimerWheel w;
+  w.now = now;
+  for(int t = 0; t < maxTimers; t++) w.due[t] = -1, w.slot[t] = -1, w.next[t] = w.prev[t] = -1;
+  for(int s = 0; s < timerLevels * timerWheelSize; s++) w.head[s] = -1;
+  return w;
+}
+
+/* Slot for a timer due on tick 'due' */
+int timerSlot(const TimerWheel &w, long due) {
+  int level = 0;
+  while(level < timerLevels - 1 && due >> timerBits * (level + 1) != w.now >> timerBits * (level + 1)) level++;
+  return level * timerWheelSize + (due >> timerBits * level & (timerWheelSize - 1));
+}
+
+void linkTimer(TimerWheel &w, int t, int s) {
+  w.slot[t] = s;
+  w.prev[t] = -1;
+  w.next[t] = w.head[s];
+  if(w.head[s] >= 0) w.prev[w.head[s]] = t;
+  w.head[s] = t;
+}
+
+void cancelTimer(TimerWheel &w, int t) {
+  if(w.due[t] < 0) return;
+  if(w.prev[t] >= 0) w.next[w.prev[t]] = w.next[t];
+  else w.head[w.slot[t]] = w.next[t];
+  if(w.next[t] >= 0) w.prev[w.next[t]] = w.prev[t];
+  w.due[t] = -1;
+  w.slot[t] = -1;
+}
+
+/* Timer 't' fires on tick 'due', at the earliest the next one. A pending
+   't' is moved */
+void scheduleTimer(TimerWheel &w, int t, long due) {
+  cancelTimer(w, t);
+  if(due <= w.now) due = w.now + 1;
+  w.due[t] = due;
+  linkTimer(w, t, timerSlot(w, due));
+}
+
+/* Tick timer 't' fires on, -1 when idle */
+long timerDue(const TimerWheel &w, int t) {
+  return w.due[t];
+}
+
+/* Files the timers of slot 's' again from the current tick */
+void cascadeTimers(TimerWheel &w, int s) {
+  int t = w.head[s];
+  w.head[s] = -1;
+  while(t >= 0) {
+    int next = w.next[t];
+    linkTimer(w, t, timerSlot(w, w.due[t]));
+    t = next;
+  }
+}
+
+/* Moves the wheel on a tick. The timers due go idle and into 'fired' in
+   the order of their numbers, so equal games fire them alike. Returns how
+   many */
+int advanceTimers(TimerWheel &w, int fired[maxTimers]) {
+  w.now++;
+  // Entering a new block, group..., from the top so timers can fall through
+  for(int level = timerLevels - 1; level > 0; level--) {
+    if(w.now & ((1L << timerBits * level) - 1)) continue;
+    cascadeTimers(w, level * timerWheelSize + (w.now >> timerBits * level & (timerWheelSize - 1)));
+  }
+  int n = 0;
+  for(int t = w.head[w.now & (timerWheelSize - 1)]; t >= 0;) {
+    int next = w.next[t];
+    cancelTimer(w, t);
+    int k = n++;
+    for(; k > 0 && fired[k - 1] > t; k--) fired[k] = fired[k - 1];
+    fired[k] = t;
+    t = next;
+  }
+  return n;
+}
+
+#endif